@@ -12,8 +12,20 @@
 #include <ctime>
 #include <iomanip>
 #include <vector>
+#include <map>
+#include <memory>
 #include "JsonFetcher.h"
 #include "MailSender.h"
+#include "Outbox.h"
+#include "Logger.h"
+#include "Notice.h"
+#include "NoticeSnapshot.h"
+#include "ExtractionPlan.h"
+#include "CycleArena.h"
+#include "NoticeArchive.h"
+#include "RateLimiter.h"
+#include "ShardCoordinator.h"
+#include "ControlServer.h"
 
 class AlertMonitor {
 public:
@@ -26,13 +38,39 @@ public:
         std::string sendkey;
     };
 
+    // 监控目标
+    struct Target {
+        std::string name;  // 目标名称（用于日志和状态目录）
+        std::string url;   // 接口URL
+        ExtractionPlan plan;  // 通知列表和字段的提取方式（默认为蓝桥杯接口）
+    };
+
+    // 多实例分片配置
+    struct ClusterConfig {
+        bool enabled = false;
+        std::string dir;          // 共享协调目录（租约、心跳和各目标状态），默认为 state_dir/cluster
+        std::string instance_id;  // 实例ID，为空时使用 主机名-进程号
+        int lease_seconds = 30;   // 租约有效期（秒）
+    };
+
     struct Config {
         int check_interval;  // 检查间隔（秒）
-        std::string target_url;  // 目标URL
-        MailSender::SmtpConfig smtp;  // 邮件配置
+        std::vector<Target> targets;  // 监控目标列表（兼容旧的 target_url）
+        std::vector<MailSender::SmtpConfig> smtp;  // 邮件中继列表（兼容单个对象）
         std::vector<std::string> trigger_keywords;  // 触发关键词列表
+        std::vector<std::string> match_fields = {"title"};  // 参与关键词匹配的字段
+        std::vector<NoticeEvent::Kind> trigger_events = {
+            NoticeEvent::Kind::New, NoticeEvent::Kind::Edited
+        };  // 触发通知的事件类型
+        bool stop_after_alert = true;  // 发送通知后停止监控
         std::vector<std::string> recipients;  // 收件人列表
         ServerChanConfig server_chan;  // Server酱推送配置
+        std::string state_dir = "state";  // 状态目录（发件箱日志等）
+        Logger::Options log;  // 日志配置
+        std::string trace_path;  // trace文件路径，为空时不启用追踪
+        std::map<std::string, RateLimiter::Limit> rate_limits;  // 按主机/渠道的限流配置
+        ClusterConfig cluster;  // 多实例分片配置
+        ControlServer::Options control;  // 控制接口（立即检查、状态查询）
     };
 
     /**
@@ -46,40 +84,183 @@ public:
     /**
      * @brief 启动监控循环
      *
+     * 非分片模式下持有状态目录锁，另一个进程正在使用同一状态目录时直接返回。
+     *
+     * @param config 监控配置
+     * @return int 退出码（停止后为 kExitNoAlert，状态目录被占用时为 kExitLocked）
+     */
+    static int run(const Config& config);
+
+    // --once 模式的退出码
+    static constexpr int kExitNoAlert = 0;         // 检查完成，没有需要提醒的通知
+    static constexpr int kExitError = 1;           // 配置错误或程序异常
+    static constexpr int kExitAlert = 2;           // 有通知命中规则并已投递
+    static constexpr int kExitFetchFailed = 3;     // 至少一个目标获取失败
+    static constexpr int kExitDeliveryFailed = 4;  // 有通知投递失败，留在发件箱中待下次重试
+    static constexpr int kExitLocked = 5;          // 另一个进程正在使用同一状态目录（上一次调用尚未结束）
+
+    /**
+     * @brief 对所有目标各检查一次后返回（供systemd timer / cron调用）
+     *
+     * 快照从状态目录恢复，检查后写回；归档和网络只在需要时初始化。
+     * 非分片模式下持有状态目录锁，上一次调用尚未结束时返回 kExitLocked。
+     *
      * @param config 监控配置
+     * @return int 退出码（kExit*）
+     */
+    static int runOnce(const Config& config);
+
+    /**
+     * @brief 离线重放录制的响应，测量 解析 → 提取 → 匹配 → 渲染 各阶段的耗时
+     *
+     * 每个响应按URL使用对应目标的提取计划（找不到时使用默认计划），其中的全部通知都作为新增事件
+     * 交给匹配，结果与录制顺序和快照无关；命中的通知按收件人渲染后交给空投递器丢弃。
+     * 不访问网络，不读写状态目录，结束后在标准输出打印吞吐量和各阶段耗时。
+     *
+     * @param config 监控配置（目标、关键词、收件人）
+     * @param path 录制文件路径
+     * @param iterations 完整重放的轮数
+     * @return int 退出码（kExitNoAlert 或 kExitError）
      */
-    static void run(const Config& config);
+    static int replay(const Config& config, const std::string& path, int iterations = 1);
 
 private:
+    // 单个目标一次检查的结果
+    enum class CheckResult {
+        Unchanged,       // 列表没有变化
+        Changed,         // 有变化但没有命中规则
+        Triggered,       // 命中规则且全部投递成功
+        FetchFailed,     // 获取或处理失败
+        DeliveryFailed,  // 命中规则但有条目投递失败
+        LeaseLost        // 检查过程中失去租约，已交由其他实例处理
+    };
+
+    // 运行状态：发件箱、各目标的快照、通知归档
+    // 分片模式下每个目标有独立的发件箱、快照和归档（位于共享目录），只在持有租约期间打开
+    struct State {
+        explicit State(const Config& config);
+
+        /**
+         * @brief 获取目标使用的通知归档，第一次调用时才打开
+         *
+         * 未启用分片时所有目标共用 state_dir/archive；分片模式下每个目标独立，
+         * 避免多个实例向同一组列文件追加（各自的字符串池ID互不相同）。
+         */
+        NoticeArchive& archive(const std::string& target);
+
+        /**
+         * @brief 获取目标使用的发件箱
+         */
+        Outbox& outboxFor(const std::string& target);
+
+        /**
+         * @brief 本实例当前是否负责该目标（未启用分片时总是负责）
+         */
+        bool owns(const std::string& target) const;
+
+        /**
+         * @brief 续期目标的租约（未启用分片时总是成功）
+         *
+         * @return true 仍负责该目标
+         */
+        bool renew(const std::string& target);
+
+        /**
+         * @brief 接管目标：从共享目录恢复快照并打开发件箱
+         */
+        void adopt(const Config& config, const Target& target);
+
+        /**
+         * @brief 移交目标：关闭发件箱和归档并丢弃快照
+         */
+        void drop(const std::string& target);
+
+        std::unique_ptr<Outbox> outbox;  // 未启用分片时所有目标共用
+        std::map<std::string, NoticeSnapshot> snapshots;  // 目标名称 -> 上一次的快照
+        std::string archiveDir;  // 未启用分片时为归档目录，分片模式下为各目标状态的上级目录
+        std::unique_ptr<NoticeArchive> archiveHandle;
+        std::map<std::string, std::unique_ptr<NoticeArchive>> targetArchives;  // 分片模式下各目标的归档
+
+        CycleArena arena;  // 每次检查的JSON内存池，检查结束后复位
+        std::string body;  // 响应缓冲区，跨检查复用
+
+        std::unique_ptr<ShardCoordinator> coordinator;  // 未启用分片时为空
+        std::map<std::string, std::unique_ptr<Outbox>> targetOutboxes;  // 本实例持有租约的目标
+    };
+
     /**
-     * @brief 检查JSON数据是否包含触发关键词
+     * @brief 检查结果的名称（用于状态查询）
+     */
+    static const char* checkResultName(CheckResult result);
+
+    /**
+     * @brief 应用日志、追踪和限流配置
      *
-     * @param json_data JSON数据
-     * @param trigger_keywords 触发关键词数组
-     * @return std::optional<std::string> 包含触发关键词的新闻项（如果有）
+     * @param config 监控配置
      */
-    static std::vector<nlohmann::json> checkForTrigger(
-        const nlohmann::json& json_data,
-        const std::vector<std::string>& trigger_keywords
+    static void setup(const Config& config);
+
+    /**
+     * @brief 目标快照文件路径
+     *
+     * @param config 监控配置
+     * @param target 监控目标
+     * @return std::string 快照文件路径
+     */
+    static std::string snapshotPath(const Config& config, const Target& target);
+
+    /**
+     * @brief 心跳并续期/获取各目标的租约，处理接管和移交
+     *
+     * @param config 监控配置
+     * @param state 运行状态
+     * @return std::vector<const Target*> 本次新接管的目标
+     */
+    static std::vector<const Target*> claimTargets(const Config& config, State& state);
+
+    /**
+     * @brief 检查一个目标：获取数据、计算变化、匹配并投递
+     *
+     * @param config 监控配置
+     * @param target 监控目标
+     * @param state 运行状态
+     * @return CheckResult 检查结果
+     */
+    static CheckResult checkTarget(
+        const Config& config,
+        const Target& target,
+        State& state
+    );
+
+    /**
+     * @brief 从变化事件中筛选命中规则的事件
+     *
+     * @param events 快照变化事件
+     * @param config 监控配置（关键词、匹配字段、事件类型）
+     * @return std::vector<NoticeEvent> 命中的事件（按发布时间降序）
+     */
+    static std::vector<NoticeEvent> checkForTrigger(
+        const std::vector<NoticeEvent>& events,
+        const Config& config
     );
 
     /**
      * @brief 将UTC时间转换为北京时间字符串
      *
      * @param utc_time UTC时间字符串（格式：2025-06-16T09:11:44）
-     * @return std::string 北京时间字符串
+     * @return std::string 北京时间字符串，无法解析时原样返回
      */
     static std::string utcToBeijingTime(const std::string& utc_time);
 
     /**
      * @brief 生成邮件内容
      *
-     * @param news_items 新闻项JSON数组
+     * @param events 命中的通知事件
      * @param trigger_keywords 触发关键词数组
      * @return std::string 格式化后的邮件内容
      */
     static std::string generateEmailContent(
-        const std::vector<nlohmann::json>& news_items,
+        const std::vector<NoticeEvent>& events,
         const std::vector<std::string>& trigger_keywords
     );
 
@@ -99,12 +280,12 @@ private:
     /**
      * @brief 生成ServerChan推送内容
      *
-     * @param news_items 新闻项JSON数组
+     * @param events 命中的通知事件
      * @param trigger_keywords 触发关键词数组
      * @return std::string 格式化后的ServerChan内容
      */
     static std::string generateServerChanContent(
-        const std::vector<nlohmann::json>& news_items,
+        const std::vector<NoticeEvent>& events,
         const std::vector<std::string>& trigger_keywords
     );
 
@@ -112,16 +293,60 @@ private:
      * @brief 发送ServerChan推送内容
      *
      * @param config ServerChan配置
-     * @param news_items 新闻项JSON数组
-     * @param trigger_keywords 触发关键词数组
+     * @param title 推送标题
+     * @param desp 推送正文（Markdown）
+     * @param brief 简短描述
      * @return true 发送成功
      * @return false 发送失败
      */
     static bool sendServerChan(
         const ServerChanConfig& config,
-        const std::vector<nlohmann::json>& news_items,
-        const std::vector<std::string>& trigger_keywords
+        const std::string& title,
+        const std::string& desp,
+        const std::string& brief
     );
 
+    /**
+     * @brief 事件在发件箱中的去重键
+     *
+     * 新增事件使用nnid，删除事件使用负的nnid；编辑事件使用由nnid和内容哈希得到的键，
+     * 已提醒过的通知被编辑后会再次提醒，同一版本只提醒一次。
+     *
+     * @param event 通知事件
+     * @return long long 去重键
+     */
+    static long long eventKey(const NoticeEvent& event);
+
+    /**
+     * @brief 为匹配的通知生成发件箱条目并组提交
+     *
+     * 已投递或已排队的 (通知, 收件人, 渠道) 会被跳过。
+     *
+     * @param config 监控配置
+     * @param outbox 发件箱
+     * @param events 命中的通知事件
+     * @return size_t 新加入发件箱的条目数
+     */
+    static size_t enqueueNotifications(
+        const Config& config,
+        Outbox& outbox,
+        const std::vector<NoticeEvent>& events
+    );
+
+    /**
+     * @brief 投递目标发件箱中所有未完成的条目
+     *
+     * 邮件条目通过所有中继并发发送，每个收件人单独记录结果。
+     * 分片模式下每轮发送前续期租约，一轮在租约有效期内结束（过半后不再开始新的发送），未发出的邮件进入下一轮；
+     * 结果写入发件箱前再次续期，租约已失效或epoch已变化时不写入，剩余条目由接管的实例投递。
+     * 收件人被服务器拒绝的邮件记录错误后移出发件箱，不计入失败数。
+     *
+     * @param config 监控配置
+     * @param state 运行状态
+     * @param target 目标名称（未启用分片时可为空）
+     * @return size_t 投递失败（仍未完成）的条目数
+     */
+    static size_t dispatchOutbox(const Config& config, State& state, const std::string& target);
+
 };
 #endif //ALERTMONITOR_H
@@ -0,0 +1,111 @@
+//
+// Created by athbe on 2026/10/18.
+//
+
+#ifndef CHECKSCHEDULER_H
+#define CHECKSCHEDULER_H
+
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <optional>
+#include <cstdint>
+
+/*
+ * 立即检查请求的调度与检查状态
+ * 控制接口线程提交请求，主循环在等待下一次检查时被唤醒并执行。
+ * 同一目标已在排队或正在检查时，新的请求会被合并，不会重复检查。
+ */
+class CheckScheduler {
+public:
+    enum class Submit {
+        Queued,    // 已加入队列
+        Pending,   // 已在队列中，合并
+        InFlight,  // 正在检查，合并
+        NotOwner,  // 分片模式下不由本实例负责
+        Unknown    // 未配置的目标
+    };
+
+    /**
+     * @param targets 所有配置的目标名称
+     */
+    explicit CheckScheduler(const std::vector<std::string>& targets);
+
+    /**
+     * @brief 请求立即检查某个目标（线程安全）
+     *
+     * @param target 目标名称
+     * @return Submit 提交结果
+     */
+    Submit request(const std::string& target);
+
+    /**
+     * @brief 等待立即检查请求，直到超时
+     *
+     * @param deadline 最迟返回时刻
+     * @return std::optional<std::string> 需要检查的目标，超时或已停止时返回空
+     */
+    std::optional<std::string> waitUntil(std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief 请求主循环停止（线程安全），唤醒正在等待的 waitUntil
+     */
+    void stop();
+
+    /**
+     * @brief 是否已请求停止
+     */
+    bool stopped() const;
+
+    /**
+     * @brief 标记目标开始检查（请求与其合并）
+     */
+    void begin(const std::string& target);
+
+    /**
+     * @brief 记录目标检查结束
+     *
+     * @param target 目标名称
+     * @param result 结果描述
+     * @param duration 检查耗时
+     */
+    void finish(const std::string& target, const std::string& result, std::chrono::milliseconds duration);
+
+    /**
+     * @brief 更新目标是否由本实例负责（分片模式）
+     */
+    void setOwned(const std::string& target, bool owned);
+
+    /**
+     * @brief 当前状态（线程安全）
+     *
+     * @return nlohmann::json 各目标最近一次检查的结果和耗时、队列和正在检查的目标
+     */
+    nlohmann::json status() const;
+
+    static const char* submitName(Submit submit);
+
+private:
+    struct TargetStatus {
+        bool owned = true;
+        uint64_t checks = 0;
+        int64_t lastCheck = 0;        // 最近一次检查开始的时间（epoch秒）
+        int64_t lastDurationMs = 0;
+        std::string lastResult;
+    };
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::string> queue_;
+    std::string inFlight_;
+    bool stopped_ = false;
+    std::map<std::string, TargetStatus> targets_;
+    std::chrono::steady_clock::time_point started_ = std::chrono::steady_clock::now();
+};
+
+#endif //CHECKSCHEDULER_H
@@ -0,0 +1,64 @@
+//
+// Created by athbe on 2026/10/18.
+//
+
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+#include <nlohmann/json.hpp>
+#include <string>
+#include <functional>
+#include <thread>
+
+/*
+ * 本地控制接口
+ * Unix套接字：每行一条命令，"check <目标>" / "check" / "status"，每条命令返回一行JSON。
+ * HTTP（仅本地）：POST /check/<目标>、POST /check、GET /status，返回JSON。
+ * 在独立线程中运行，命令交给回调处理。
+ */
+class ControlServer {
+public:
+    struct Options {
+        std::string socket_path;              // Unix套接字路径，为空时不启用
+        std::string http_bind = "127.0.0.1";  // HTTP监听地址
+        int http_port = 0;                    // HTTP端口，0表示不启用
+    };
+
+    /**
+     * @brief 命令处理回调
+     *
+     * 参数为命令（check / status）和目标名称（check 不带目标时为空），返回JSON结果；
+     * 结果中带 "error" 字段表示请求无效。
+     */
+    using Handler = std::function<nlohmann::json(const std::string& command, const std::string& target)>;
+
+    /**
+     * @brief 打开监听套接字并启动服务线程
+     *
+     * @param options 监听配置
+     * @param handler 命令处理回调（在服务线程中调用）
+     */
+    ControlServer(Options options, Handler handler);
+
+    /**
+     * @brief 停止服务线程，关闭套接字并删除套接字文件
+     */
+    ~ControlServer();
+
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+
+private:
+    void serve();
+    void handleLines(int fd);
+    void handleHttp(int fd);
+
+    Options options_;
+    Handler handler_;
+    int unixFd_ = -1;
+    int httpFd_ = -1;
+    int stopPipe_[2] = {-1, -1};
+    std::thread thread_;
+};
+
+#endif //CONTROLSERVER_H
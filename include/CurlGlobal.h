@@ -0,0 +1,26 @@
+//
+// Created by athbe on 2026/10/18.
+//
+
+#ifndef CURLGLOBAL_H
+#define CURLGLOBAL_H
+
+#include <mutex>
+#include <curl/curl.h>
+
+/*
+ * libcurl全局初始化
+ * 延迟到第一次发起请求时执行，不需要网络的运行（例如查询归档）不付出初始化开销。
+ */
+class CurlGlobal {
+public:
+    /**
+     * @brief 确保curl_global_init已执行（线程安全，只执行一次）
+     */
+    static void ensureInit() {
+        static std::once_flag once;
+        std::call_once(once, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+    }
+};
+
+#endif //CURLGLOBAL_H
@@ -0,0 +1,131 @@
+//
+// Created by athbe on 2026/10/18.
+//
+
+#ifndef CYCLEARENA_H
+#define CYCLEARENA_H
+
+#include <nlohmann/json.hpp>
+#include <memory_resource>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * 每次检查使用的单调内存池
+ * 获取 → 解析 → 匹配 → 渲染过程中的JSON节点和字符串都从这里分配，释放是空操作；
+ * 检查结束后一次性复位，内存块保留给下一次检查复用。
+ * 长期运行时堆上不再反复分配大量小对象，内存占用稳定在单次检查的峰值。
+ */
+class CycleArena : public std::pmr::memory_resource {
+public:
+    /**
+     * @param block_size 每个内存块的大小（超过该大小的分配单独占用一块）
+     */
+    explicit CycleArena(size_t block_size = 64 * 1024);
+
+    CycleArena(const CycleArena&) = delete;
+    CycleArena& operator=(const CycleArena&) = delete;
+
+    /**
+     * @brief 回收本次检查的全部分配（保留内存块）
+     *
+     * 调用前必须销毁所有从本内存池分配的对象。
+     */
+    void reset();
+
+    /**
+     * @brief 已持有的内存块总大小
+     */
+    size_t capacity() const { return capacity_; }
+
+    /**
+     * @brief 当前线程正在使用的内存池，没有时为普通堆
+     */
+    static std::pmr::memory_resource* current();
+
+    /*
+     * 作用域内当前线程的 ArenaJson / ArenaString 从该内存池分配，离开作用域时复位内存池
+     */
+    class Scope {
+    public:
+        explicit Scope(CycleArena& arena);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        CycleArena& arena_;
+        std::pmr::memory_resource* previous_;
+    };
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size = 0;
+    };
+
+    std::vector<Block> blocks_;
+    size_t blockSize_;
+    size_t current_ = 0;   // 正在使用的内存块
+    size_t offset_ = 0;    // 当前块中已使用的字节数
+    size_t capacity_ = 0;
+};
+
+/*
+ * 从当前线程的内存池分配的分配器
+ * nlohmann::basic_json 在内部默认构造分配器，因此内存池通过线程局部变量传递。
+ */
+template<typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator() noexcept : resource_(CycleArena::current()) {}
+
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : resource_(other.resource()) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(resource_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        resource_->deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    std::pmr::memory_resource* resource() const noexcept { return resource_; }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept { return resource_ == other.resource(); }
+
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const noexcept { return resource_ != other.resource(); }
+
+private:
+    std::pmr::memory_resource* resource_;
+};
+
+// 从内存池分配的字符串
+using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+// 从内存池分配的JSON：对象使用按插入顺序存储的扁平数组（ordered_map），接口返回的对象通常只有十几个键
+using ArenaJson = nlohmann::basic_json<
+    nlohmann::ordered_map,
+    std::vector,
+    ArenaString,
+    bool,
+    std::int64_t,
+    std::uint64_t,
+    double,
+    ArenaAllocator
+>;
+
+#endif //CYCLEARENA_H
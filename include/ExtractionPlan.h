@@ -0,0 +1,86 @@
+//
+// Created by athbe on 2026/10/18.
+//
+
+#ifndef EXTRACTIONPLAN_H
+#define EXTRACTIONPLAN_H
+
+#include <string>
+#include <vector>
+#include "Notice.h"
+#include "CycleArena.h"
+
+/*
+ * 通知提取计划
+ * 每个目标用JSON Pointer声明列表位置和各字段位置，以及通知链接模板。
+ * 加载配置时编译一次：指针预先拆分为路径步骤，链接模板拆分为文本片段和占位符，
+ * 提取时每个字段按路径逐级直接查找，不再重复解析。
+ */
+class ExtractionPlan {
+public:
+    // 字段映射（默认值为蓝桥杯大赛接口）
+    struct Mapping {
+        std::string list = "/datalist";          // 通知列表（相对于接口返回的JSON）
+        std::string id = "/nnid";                // 以下字段均相对于列表中的每一项
+        std::string title = "/title";
+        std::string time = "/creatTime";
+        std::string category = "/programaName";
+        std::string summary = "/synopsis";
+        std::string link = "https://dasai.lanqiao.cn/notices/{id}";  // 链接模板，可用 {id} {title} {time} {category}
+    };
+
+    /**
+     * @brief 使用默认映射（蓝桥杯大赛接口）
+     */
+    ExtractionPlan();
+
+    /**
+     * @brief 编译字段映射
+     *
+     * @param mapping 字段映射
+     * @throws std::runtime_error JSON Pointer 或链接模板无效
+     */
+    explicit ExtractionPlan(const Mapping& mapping);
+
+    /**
+     * @brief 从接口返回的JSON中提取通知列表
+     *
+     * 数字ID直接使用；字符串ID为纯数字时按数字解析，否则取其哈希；没有ID时取标题哈希。
+     *
+     * @param document 接口返回的JSON数据
+     * @return std::vector<Notice> 通知列表（已计算内容哈希）
+     */
+    std::vector<Notice> extract(const ArenaJson& document) const;
+
+private:
+    // 路径中的一步：对象按键查找，数组按下标访问
+    struct Step {
+        std::string key;
+        size_t index = 0;
+        bool numeric = false;  // key 可作为数组下标
+    };
+    using Path = std::vector<Step>;
+
+    enum class Field { None, Id, Title, Time, Category };
+
+    // 链接模板片段：文本或占位符
+    struct Segment {
+        std::string text;
+        Field field = Field::None;
+    };
+
+    static Path compilePointer(const std::string& pointer);
+    static std::vector<Segment> compileTemplate(const std::string& link);
+    static const ArenaJson* resolve(const ArenaJson& root, const Path& path);
+    static std::string stringAt(const ArenaJson& item, const Path& path);
+
+    Path list_;
+    Path id_;
+    Path title_;
+    Path time_;
+    Path category_;
+    Path summary_;
+    std::vector<Segment> link_;
+};
+
+#endif //EXTRACTIONPLAN_H
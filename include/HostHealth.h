@@ -0,0 +1,123 @@
+//
+// Created by athbe on 2026/10/18.
+//
+
+#ifndef HOSTHEALTH_H
+#define HOSTHEALTH_H
+
+#include <string>
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <cstddef>
+
+/*
+ * 按主机统计请求延迟并维护熔断器
+ * 延迟样本用于计算对冲请求的触发时机（p95）和自适应超时；
+ * 连续失败达到阈值后熔断器打开，冷却结束后以半开状态放行单个探测请求。
+ */
+class HostHealth {
+public:
+    using Millis = std::chrono::milliseconds;
+
+    enum class State {
+        Closed,    // 正常放行
+        Open,      // 熔断中，拒绝请求
+        HalfOpen   // 冷却结束，仅放行一个探测请求
+    };
+
+    /**
+     * @brief 获取指定主机的统计对象（进程内唯一）
+     *
+     * @param host 主机名
+     * @return HostHealth& 统计对象
+     */
+    static HostHealth& forHost(const std::string& host);
+
+    /**
+     * @brief 从URL中提取主机名
+     *
+     * @param url 完整URL
+     * @return std::string 主机名，解析失败时返回原URL
+     */
+    static std::string hostOf(const std::string& url);
+
+    /**
+     * @brief 判断熔断器是否放行本次请求
+     *
+     * 半开状态下只有第一个调用者获得探测机会。
+     *
+     * @return true 允许发送请求
+     */
+    bool allowRequest();
+
+    /**
+     * @brief 记录一次成功请求
+     *
+     * @param latency 请求耗时
+     */
+    void recordSuccess(Millis latency);
+
+    /**
+     * @brief 记录一次失败请求
+     */
+    void recordFailure();
+
+    /**
+     * @brief 对冲请求的触发延迟（观测到的p95）
+     *
+     * @return std::optional<Millis> 样本不足或处于半开状态时返回std::nullopt
+     */
+    std::optional<Millis> hedgeDelay() const;
+
+    /**
+     * @brief 根据观测延迟计算的请求超时
+     *
+     * @return Millis 超时时间
+     */
+    Millis timeout() const;
+
+    /**
+     * @brief 当前熔断器状态
+     */
+    State state() const;
+
+    /**
+     * @brief 熔断器打开时距离下次探测的剩余时间
+     */
+    Millis retryAfter() const;
+
+private:
+    HostHealth() = default;
+
+    /**
+     * @brief 计算延迟分位数（调用方持有 mutex_）
+     *
+     * @param q 分位数（0~1）
+     * @return Millis 分位延迟
+     */
+    Millis percentile(double q) const;
+
+    static constexpr size_t kWindow = 64;            // 延迟滑动窗口大小
+    static constexpr size_t kMinSamples = 8;         // 启用对冲/自适应超时的最少样本数
+    static constexpr int kFailureThreshold = 3;      // 连续失败多少次后熔断
+    static constexpr Millis kDefaultTimeout{15000};  // 样本不足时的超时
+    static constexpr Millis kMinTimeout{2000};
+    static constexpr Millis kMaxTimeout{15000};
+    static constexpr Millis kBaseCooldown{30000};    // 首次熔断冷却时间
+    static constexpr Millis kMaxCooldown{600000};    // 冷却时间上限
+
+    mutable std::mutex mutex_;
+    std::array<long long, kWindow> samples_{};
+    size_t sampleCount_ = 0;
+    size_t sampleHead_ = 0;
+
+    State state_ = State::Closed;
+    int consecutiveFailures_ = 0;
+    bool probeInFlight_ = false;
+    Millis cooldown_ = kBaseCooldown;
+    std::chrono::steady_clock::time_point openedAt_{};
+};
+
+#endif //HOSTHEALTH_H
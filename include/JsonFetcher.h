@@ -4,20 +4,31 @@
 
 #ifndef JSONFETCHER_H
 #define JSONFETCHER_H
-#include <nlohmann/json.hpp>
 #include <string>
-#include <optional>
 #include <curl/curl.h>
 
 class JsonFetcher {
 public:
     /**
-     * @brief 从指定URL获取并解析JSON数据
+     * @brief 获取指定URL的原始响应内容（不解析）
      *
-     * @param url 要获取的JSON数据URL
-     * @return std::optional<nlohmann::json> 解析后的JSON对象，如果失败则返回std::nullopt
+     * 超时时间按主机的观测延迟自适应调整；请求耗时超过该主机的p95时
+     * 会发出一个对冲请求，取先返回的响应。主机连续失败时熔断，直接返回失败。
+     * 由调用方选择解析方式（例如解析到每次检查的内存池中）。
+     *
+     * @param url 请求URL
+     * @param body 输出：响应内容
+     * @return bool 是否获得HTTP 200响应
      */
-    static std::optional<nlohmann::json> fetchFromUrl(const std::string& url);
+    static bool fetchBody(const std::string& url, std::string& body);
+
+    /**
+     * @brief 开始录制：此后 fetchBody 获得的每个响应（含状态码、耗时和响应头，非200响应也录制）都追加到录制文件
+     *
+     * @param path 录制文件路径
+     * @throws std::runtime_error 文件无法打开或不是录制文件
+     */
+    static void startRecording(const std::string& path);
 
     /**
      * @brief 获取最后一次错误信息
@@ -38,6 +49,30 @@ private:
      */
     static size_t writeCallback(void* contents, size_t size, size_t nmemb, void* userp);
 
+    /**
+     * @brief 创建并配置一个GET请求句柄
+     *
+     * @param url 请求URL
+     * @param response 响应缓冲区
+     * @param timeout_ms 超时时间（毫秒）
+     * @param headers 响应头缓冲区，为空时不收集响应头
+     * @return CURL* 请求句柄，失败返回nullptr
+     */
+    static CURL* createHandle(const std::string& url, std::string& response, long timeout_ms,
+                              std::string* headers = nullptr);
+
+    /**
+     * @brief 执行请求，必要时发出对冲请求
+     *
+     * @param url 请求URL
+     * @param response 输出：获胜请求的响应内容；没有200响应时为服务器返回的错误响应
+     * @param headers 输出：对应的响应头，为空时不收集
+     * @param status 输出：对应的HTTP状态码，没有收到响应（传输失败）时为0
+     * @return bool 是否获得HTTP 200响应
+     */
+    static bool performHedged(const std::string& url, std::string& response, std::string* headers = nullptr,
+                              long* status = nullptr);
+
     // 错误信息缓冲区
     static thread_local std::string lastError;
 };
@@ -0,0 +1,119 @@
+//
+// Created by athbe on 2026/10/18.
+//
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <charconv>
+
+/*
+ * 异步日志
+ * 调用方只把格式化好的消息写入无锁环形缓冲区，由后台线程负责加时间戳、
+ * 输出文本或JSON行、抑制重复错误并批量刷新。缓冲区满时调用方等待而不是丢弃，
+ * shutdown() 会写完缓冲区中的所有消息，之后的消息同步输出。文本格式下警告和错误写入stderr，
+ * 其余写入stdout，切换流之前先刷新，两者重定向到同一文件时仍保持顺序。
+ *
+ * 用法：Logger::info() << "检查间隔: " << interval << "秒";
+ */
+class Logger {
+public:
+    enum class Level {
+        Debug = 0,
+        Info,
+        Warn,
+        Error
+    };
+
+    enum class Format {
+        Text,   // 可读文本，Info及以下输出到stdout，Warn及以上输出到stderr
+        Json    // JSON行，全部输出到stdout
+    };
+
+    struct Options {
+        Level level = Level::Info;
+        Format format = Format::Text;
+        int rate_limit_seconds = 60;  // 相同的警告/错误在该时间内只输出一次，0表示不限制
+    };
+
+    // 单条消息的最大长度（字节），超出部分被截断
+    static constexpr size_t kMaxMessage = 496;
+
+    /*
+     * 单条日志的构造器，析构时提交到缓冲区
+     */
+    class Line {
+    public:
+        Line(Level level, bool enabled) : level_(level), enabled_(enabled) {}
+        ~Line();
+
+        Line(const Line&) = delete;
+        Line& operator=(const Line&) = delete;
+
+        Line& operator<<(std::string_view text);
+        Line& operator<<(const std::string& text) { return *this << std::string_view(text); }
+        Line& operator<<(const char* text) { return *this << std::string_view(text ? text : "(null)"); }
+        Line& operator<<(char c) { return *this << std::string_view(&c, 1); }
+        Line& operator<<(bool value) { return *this << (value ? "true" : "false"); }
+        Line& operator<<(double value);
+
+        template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+        Line& operator<<(T value) {
+            if (enabled_) {
+                auto result = std::to_chars(buffer_ + length_, buffer_ + kMaxMessage, value);
+                if (result.ec == std::errc()) {
+                    length_ = static_cast<size_t>(result.ptr - buffer_);
+                }
+            }
+            return *this;
+        }
+
+    private:
+        Level level_;
+        bool enabled_;
+        size_t length_ = 0;
+        char buffer_[kMaxMessage];
+    };
+
+    /**
+     * @brief 更新日志选项（可在运行中调用）
+     *
+     * @param options 日志选项
+     */
+    static void configure(const Options& options);
+
+    /**
+     * @brief 解析日志级别名称（debug/info/warn/error）
+     *
+     * @param name 级别名称
+     * @return Level 日志级别，无法识别时返回Info
+     */
+    static Level parseLevel(const std::string& name);
+
+    static Line debug() { return Line(Level::Debug, enabled(Level::Debug)); }
+    static Line info() { return Line(Level::Info, enabled(Level::Info)); }
+    static Line warn() { return Line(Level::Warn, enabled(Level::Warn)); }
+    static Line error() { return Line(Level::Error, enabled(Level::Error)); }
+
+    /**
+     * @brief 写完缓冲区中的全部消息并停止后台线程
+     *
+     * 进程正常退出时自动调用（atexit）；SIGTERM / SIGINT 由监控循环处理，退出前同样会调用。
+     */
+    static void shutdown();
+
+private:
+    static bool enabled(Level level);
+
+    /**
+     * @brief 将消息放入环形缓冲区（缓冲区满时等待）
+     */
+    static void submit(Level level, const char* text, size_t length);
+};
+
+#endif //LOGGER_H
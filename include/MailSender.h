@@ -6,6 +6,7 @@
 #define MAILSENDER_H
 #include <string>
 #include <vector>
+#include <chrono>
 #include <curl/curl.h>
 
 class MailSender {
@@ -17,6 +18,25 @@ public:
         std::string username;
         std::string password;
         bool useSsl = true; // 默认使用SSL
+        int weight = 1;           // 多个中继之间按权重分配连接
+        int maxConnections = 4;   // 批量发送时同时打开的最大连接数
+    };
+
+    // 批量发送中的一封邮件（单个收件人）
+    struct Message {
+        std::string recipient;
+        std::string subject;
+        std::string body;
+    };
+
+    // 单个收件人的投递结果
+    struct Result {
+        bool ok = false;
+        std::string relay;   // 最后一次尝试使用的中继（服务器:端口）
+        std::string error;   // 失败原因
+        int attempts = 0;    // 尝试过的中继数
+        bool deferred = false;  // 截止时间前未能发出（未开始或被中止），可以稍后重试
+        bool permanent = false; // 永久失败（收件人被拒绝），重试也不会成功
     };
 
     /**
@@ -49,6 +69,29 @@ public:
                     const std::string& subject,
                     const std::string& message);
 
+    /**
+     * @brief 通过多个中继并发批量发送邮件
+     *
+     * 每条SMTP连接由一个工作线程驱动，连续发送多封邮件时复用连接；每个中继的连接数不超过其上限，
+     * 新连接优先分配给 (已有连接数 / 权重) 最小的中继。
+     * 连接或认证失败时换用尚未尝试过的中继重发；熔断中的中继（按 "smtp:服务器:端口" 统计）不再分配。
+     * 收件人被服务器拒绝（550/551/553）属于永久失败（Result::permanent），不会换中继重试。
+     * 超过 startBy 后不再开始新的发送，进行中的传输到 finishBy 时超时中止，这些邮件标记为 deferred
+     * （被中止的邮件可能已被服务器接收，finishBy 应留出足够的余量）。
+     *
+     * @param relays 中继列表（至少一个）
+     * @param messages 待发送邮件
+     * @param startBy 最迟开始发送的时间（默认不限）
+     * @param finishBy 所有传输的截止时间（默认不限）
+     * @return std::vector<Result> 与 messages 一一对应的投递结果
+     */
+    static std::vector<Result> sendBatch(const std::vector<SmtpConfig>& relays,
+                                         const std::vector<Message>& messages,
+                                         std::chrono::steady_clock::time_point startBy =
+                                             std::chrono::steady_clock::time_point::max(),
+                                         std::chrono::steady_clock::time_point finishBy =
+                                             std::chrono::steady_clock::time_point::max());
+
     /**
      * @brief 获取libcurl版本信息
      *
@@ -82,6 +125,19 @@ private:
                            const std::vector<std::string>& recipients,
                            const std::string& email_text);
 
+    /**
+     * @brief 设置一次SMTP发送的CURL选项
+     *
+     * @param curl CURL对象（可以是复用的句柄）
+     * @param config SMTP配置
+     * @param recipient_list 收件人列表
+     * @param email_text 邮件内容（发送过程中被逐步消耗）
+     */
+    static void configureHandle(CURL* curl,
+                                const SmtpConfig& config,
+                                curl_slist* recipient_list,
+                                std::string* email_text);
+
     /**
      * @brief 构建邮件头部信息
      *
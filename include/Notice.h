@@ -0,0 +1,34 @@
+//
+// Created by athbe on 2026/10/18.
+//
+
+#ifndef NOTICE_H
+#define NOTICE_H
+
+#include <string>
+#include <cstdint>
+
+// 从接口数据中提取出的一条通知
+struct Notice {
+    long long nnid = 0;          // 通知ID
+    std::string title;           // 标题
+    std::string creatTime;       // 发布时间（UTC，格式：2025-06-16T09:11:44；其他格式原样保留）
+    std::string programaName;    // 栏目名称
+    std::string synopsis;        // 简介
+    std::string link;            // 通知链接（按目标的链接模板生成）
+    uint64_t hash = 0;           // 内容哈希，用于识别编辑
+};
+
+// 两次快照之间的变化
+struct NoticeEvent {
+    enum class Kind {
+        New,      // 新出现的通知
+        Edited,   // 标题、简介或栏目发生变化
+        Removed   // 从列表中被删除
+    };
+
+    Kind kind = Kind::New;
+    Notice notice;
+};
+
+#endif //NOTICE_H
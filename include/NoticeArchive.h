@@ -0,0 +1,189 @@
+//
+// Created by athbe on 2026/10/18.
+//
+
+#ifndef NOTICEARCHIVE_H
+#define NOTICEARCHIVE_H
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <cstdint>
+#include "Notice.h"
+
+/*
+ * 通知归档（只追加的列式存储）
+ * 每列一个文件：nnid、发布时间（epoch秒）、栏目/标题/简介（字符串池ID）。
+ * 字符串去重后存入字符串池；每1024行记录一次时间范围（区块索引），
+ * 查询时通过mmap直接扫描，按时间范围跳过无关区块。
+ */
+class NoticeArchive {
+public:
+    static constexpr size_t kBlockRows = 1024;  // 区块索引的粒度
+
+    // 一行归档记录（字符串指向mmap区域，Reader存活期间有效）
+    struct Row {
+        long long nnid = 0;
+        int64_t epoch = 0;
+        std::string_view programa;
+        std::string_view title;
+        std::string_view synopsis;
+    };
+
+    /*
+     * 只读视图，打开时映射各列文件
+     */
+    class Reader {
+    public:
+        explicit Reader(const std::string& dir);
+        ~Reader();
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        /**
+         * @brief 归档中的行数
+         */
+        size_t rows() const { return rows_; }
+
+        /**
+         * @brief 读取第 index 行
+         */
+        Row row(size_t index) const;
+
+        /**
+         * @brief 扫描发布时间位于 [from, to] 内的所有行
+         *
+         * @param from 起始时间（epoch秒，含）
+         * @param to 结束时间（epoch秒，含）
+         * @param fn 对每个命中的行调用 fn(const Row&)
+         */
+        template <typename Fn>
+        void scan(int64_t from, int64_t to, Fn&& fn) const {
+            for (const auto& [begin, end] : candidateRanges(from, to)) {
+                for (size_t i = begin; i < end; ++i) {
+                    int64_t epoch = epochs_[i];
+                    if (epoch < from || epoch > to) continue;
+                    fn(row(i));
+                }
+            }
+        }
+
+    private:
+        struct Mapping {
+            const char* data = nullptr;
+            size_t size = 0;
+        };
+
+        /**
+         * @brief 根据区块索引计算需要扫描的行区间
+         */
+        std::vector<std::pair<size_t, size_t>> candidateRanges(int64_t from, int64_t to) const;
+
+        std::string_view string(uint32_t id) const;
+
+        static Mapping map(const std::string& path);
+
+        std::vector<Mapping> mappings_;
+        size_t rows_ = 0;
+        size_t stringCount_ = 0;
+        size_t blockCount_ = 0;
+
+        const int64_t* nnids_ = nullptr;
+        const int64_t* epochs_ = nullptr;
+        const uint32_t* programas_ = nullptr;
+        const uint32_t* titles_ = nullptr;
+        const uint32_t* synopses_ = nullptr;
+        const uint64_t* stringEnds_ = nullptr;
+        const char* stringData_ = nullptr;
+        const int64_t* blocks_ = nullptr;  // 每个区块两个值：最小时间、最大时间
+    };
+
+    /**
+     * @brief 打开（或创建）归档目录用于追加
+     *
+     * 打开期间持有目录的独占锁，同一归档同时只能有一个写入者。
+     *
+     * @param dir 归档目录
+     * @throws std::runtime_error 无法打开，或归档正被其他进程写入
+     */
+    explicit NoticeArchive(const std::string& dir);
+
+    ~NoticeArchive();
+
+    NoticeArchive(const NoticeArchive&) = delete;
+    NoticeArchive& operator=(const NoticeArchive&) = delete;
+
+    /**
+     * @brief 追加一条通知，内容完全相同的记录只保存一次
+     *
+     * @param notice 通知
+     * @return true 写入了新行
+     */
+    bool append(const Notice& notice);
+
+    /**
+     * @brief 将UTC时间字符串转换为epoch秒
+     *
+     * @param utc_time UTC时间字符串（格式：2025-06-16T09:11:44）
+     * @return int64_t epoch秒，解析失败返回0
+     */
+    static int64_t parseTime(const std::string& utc_time);
+
+private:
+    /**
+     * @brief 把字符串放入字符串池，返回其ID
+     */
+    uint32_t intern(const std::string& text);
+
+    /**
+     * @brief 为打开时已有的字符串建立索引（首次追加时调用）
+     */
+    void indexStrings();
+
+    /**
+     * @brief 修复崩溃留下的不完整行，通过mmap重建字符串偏移、去重集合和区块索引
+     */
+    void recover();
+
+    /**
+     * @brief 关闭所有列文件并释放写入者锁
+     */
+    void closeFiles();
+
+    static uint64_t rowKey(long long nnid, uint32_t programa, uint32_t title, uint32_t synopsis);
+
+    std::string dir_;
+    int lockFd_ = -1;  // 写入者锁（flock）
+    int nnidFd_ = -1;
+    int epochFd_ = -1;
+    int programaFd_ = -1;
+    int titleFd_ = -1;
+    int synopsisFd_ = -1;
+    int stringDataFd_ = -1;
+    int stringEndFd_ = -1;
+    int blockFd_ = -1;
+
+    size_t rows_ = 0;
+    size_t stringCount_ = 0;
+    uint64_t stringBytes_ = 0;
+    int64_t blockMin_ = 0;
+    int64_t blockMax_ = 0;
+
+    // 打开时已有的字符串池（mmap），字符串内容不复制到内存
+    const uint64_t* poolEnds_ = nullptr;
+    const char* poolData_ = nullptr;
+    size_t poolCount_ = 0;
+    uint64_t poolBytes_ = 0;
+
+    bool stringsIndexed_ = false;
+    std::unordered_map<std::string_view, uint32_t> strings_;  // 指向字符串池或 added_
+    std::deque<std::string> added_;                          // 打开后新增的字符串
+    std::unordered_set<uint64_t> rowKeys_;
+};
+
+#endif //NOTICEARCHIVE_H
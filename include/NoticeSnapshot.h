@@ -0,0 +1,79 @@
+//
+// Created by athbe on 2026/10/18.
+//
+
+#ifndef NOTICESNAPSHOT_H
+#define NOTICESNAPSHOT_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "Notice.h"
+
+/*
+ * 单个监控目标的上一次快照
+ * 以nnid为键保存每条通知的内容哈希，与新一次的结果比较得到
+ * 新增 / 编辑 / 删除事件，只有这些变化会交给匹配和渲染。
+ */
+class NoticeSnapshot {
+public:
+    /**
+     * @brief 计算通知的内容哈希（标题、简介、栏目）
+     *
+     * @param notice 通知
+     * @return uint64_t 64位FNV-1a哈希
+     */
+    static uint64_t contentHash(const Notice& notice);
+
+    /**
+     * @brief 计算最新结果相对快照的变化（不修改快照）
+     *
+     * 列表是分页的，较旧的通知会被新通知挤出页面。只有当比它更早的通知仍在列表中时，
+     * 消失的通知才被视为删除；否则认为它只是翻页移出，不产生事件。
+     *
+     * @param current 最新的通知列表
+     * @return std::vector<NoticeEvent> 新增、编辑、删除事件
+     */
+    std::vector<NoticeEvent> diff(const std::vector<Notice>& current) const;
+
+    /**
+     * @brief 用最新结果替换快照内容
+     *
+     * 应在变化已被可靠处理（写入发件箱并落盘）之后调用，处理失败时下一次检查仍能得到同样的变化。
+     *
+     * @param current 最新的通知列表（为空时保留原快照）
+     */
+    void apply(const std::vector<Notice>& current);
+
+    /**
+     * @brief 从磁盘恢复快照
+     *
+     * @param path 快照文件路径
+     * @return true 读取成功；文件不存在或损坏时返回false并保持空快照
+     */
+    bool load(const std::string& path);
+
+    /**
+     * @brief 将快照写入磁盘（紧凑二进制格式，写临时文件后原子替换）
+     *
+     * @param path 快照文件路径
+     */
+    void save(const std::string& path) const;
+
+    /**
+     * @brief 快照中的通知数量
+     */
+    size_t size() const { return entries_.size(); }
+
+private:
+    struct Entry {
+        Notice notice;
+        uint64_t generation = 0;
+    };
+
+    std::unordered_map<long long, Entry> entries_;
+    uint64_t generation_ = 0;
+};
+
+#endif //NOTICESNAPSHOT_H
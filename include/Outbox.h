@@ -0,0 +1,129 @@
+//
+// Created by athbe on 2026/10/18.
+//
+
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+/*
+ * 通知发件箱（预写日志）
+ * 每条通知在投递前先追加到日志，投递确认后再追加完成标记。
+ * 日志按批次fsync（组提交），启动时重放未完成的条目，
+ * 并以 (通知, 收件人, 渠道) 为键去重，保证同一通知不会重复投递。
+ */
+class Outbox {
+public:
+    // 发件箱条目（一次投递）
+    struct Entry {
+        uint64_t id = 0;                // 条目序号
+        std::string channel;            // 投递渠道：mail / serverchan
+        std::string recipient;          // 收件人（邮箱地址或Server酱UID）
+        std::string subject;            // 标题
+        std::string body;               // 正文
+        std::string brief;              // 简短描述（Server酱使用）
+        std::vector<long long> nnids;   // 本条目包含的通知ID
+    };
+
+    /**
+     * @brief 打开（或创建）发件箱日志，并重放已有记录
+     *
+     * 只有过期记录较多或末尾有不完整记录时才重写日志，
+     * 平时打开发件箱不产生写入和fsync。
+     * 打开期间持有 <path>.lock 上的排他锁（flock），同一发件箱只能由一个进程使用。
+     *
+     * @param path 日志文件路径
+     * @throws std::runtime_error 日志无法打开，或发件箱正被其他进程使用
+     */
+    explicit Outbox(const std::string& path);
+
+    ~Outbox();
+
+    Outbox(const Outbox&) = delete;
+    Outbox& operator=(const Outbox&) = delete;
+
+    /**
+     * @brief 判断通知是否已投递或已在发件箱中等待投递
+     *
+     * @param nnid 通知ID
+     * @param channel 投递渠道
+     * @param recipient 收件人
+     * @return true 已投递或已排队
+     */
+    bool contains(long long nnid, const std::string& channel, const std::string& recipient) const;
+
+    /**
+     * @brief 追加一条待投递条目（仅写入，不fsync）
+     *
+     * @param entry 条目内容，id由发件箱分配
+     * @return uint64_t 分配的条目序号
+     */
+    uint64_t enqueue(Entry entry);
+
+    /**
+     * @brief 标记条目已投递（仅写入，不fsync）
+     *
+     * @param id 条目序号
+     */
+    void markDone(uint64_t id);
+
+    /**
+     * @brief 组提交：保证此前追加的所有记录落盘
+     *
+     * 并发调用时只有一个线程执行fsync，其余线程等待同一批次完成。
+     */
+    void commit();
+
+    /**
+     * @brief 获取所有未完成的条目（按序号升序）
+     *
+     * @return std::vector<Entry> 待投递条目
+     */
+    std::vector<Entry> pending() const;
+
+private:
+    /**
+     * @brief 读取日志文件并恢复内存状态
+     */
+    void replay();
+
+    /**
+     * @brief 重写日志，只保留投递记录和未完成条目
+     */
+    void compact();
+
+    /**
+     * @brief 追加一行记录到日志
+     *
+     * @param line 单行JSON记录
+     */
+    void appendLine(const std::string& line);
+
+    static std::string makeKey(long long nnid, const std::string& channel, const std::string& recipient);
+
+    std::string path_;
+    int fd_ = -1;
+    int lockFd_ = -1;  // 发件箱锁（flock）
+
+    mutable std::mutex mutex_;
+    std::condition_variable synced_;
+    bool syncing_ = false;
+    uint64_t writtenLsn_ = 0;   // 已写入的字节偏移
+    uint64_t durableLsn_ = 0;   // 已fsync的字节偏移
+
+    uint64_t nextId_ = 1;
+    size_t obsoleteRecords_ = 0;  // 已完成条目占用的记录数
+    bool tornTail_ = false;       // 日志末尾存在不完整的记录
+    std::map<uint64_t, Entry> pending_;
+    std::unordered_set<std::string> delivered_;
+    std::unordered_set<std::string> queued_;
+};
+
+#endif //OUTBOX_H
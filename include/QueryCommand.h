@@ -0,0 +1,46 @@
+//
+// Created by athbe on 2026/10/18.
+//
+
+#ifndef QUERYCOMMAND_H
+#define QUERYCOMMAND_H
+
+#include <string>
+#include <vector>
+
+/*
+ * lqNotice query 子命令：扫描通知归档
+ *
+ * lqNotice query [--archive 目录] [--from 2025-01-01] [--to 2025-12-31]
+ *                [--keywords 获奖名单,总决赛] [--fields title,synopsis]
+ *                [--programa 栏目名] [--stats]
+ */
+class QueryCommand {
+public:
+    /**
+     * @brief 执行查询
+     *
+     * @param args query之后的命令行参数
+     * @return int 进程退出码
+     */
+    static int run(const std::vector<std::string>& args);
+
+private:
+    /**
+     * @brief 解析日期（北京时间）为epoch秒
+     *
+     * @param date 日期字符串（格式：2025-06-16）
+     * @param end_of_day 为true时返回当天最后一秒
+     * @return long long epoch秒
+     */
+    static long long parseDate(const std::string& date, bool end_of_day);
+
+    /**
+     * @brief 将epoch秒格式化为北京时间
+     */
+    static std::string formatTime(long long epoch);
+
+    static void printUsage();
+};
+
+#endif //QUERYCOMMAND_H
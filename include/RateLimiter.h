@@ -0,0 +1,51 @@
+//
+// Created by athbe on 2026/10/18.
+//
+
+#ifndef RATELIMITER_H
+#define RATELIMITER_H
+
+#include <string>
+#include <chrono>
+
+/*
+ * 按主机/渠道划分的令牌桶限流
+ * 键的约定：接口请求使用主机名，邮件使用 "smtp:服务器:端口"，Server酱使用 "serverchan"。
+ * 未配置的键不限流。
+ */
+class RateLimiter {
+public:
+    struct Limit {
+        double rate = 0;    // 每秒补充的令牌数，0表示不限流
+        double burst = 1;   // 桶容量（允许的突发请求数）
+    };
+
+    /**
+     * @brief 设置某个键的限流参数（应在启动阶段调用）
+     *
+     * @param key 主机名或渠道
+     * @param limit 限流参数
+     */
+    static void configure(const std::string& key, const Limit& limit);
+
+    /**
+     * @brief 获取一个令牌，必要时等待
+     *
+     * 令牌不足时预留下一个令牌并睡眠到其可用时刻，多个等待者按到达顺序依次放行，
+     * 实际速率恰好达到配置上限而不超出。
+     *
+     * @param key 主机名或渠道
+     * @return std::chrono::milliseconds 实际等待的时间
+     */
+    static std::chrono::milliseconds acquire(const std::string& key);
+
+    /**
+     * @brief 尝试获取一个令牌，不等待
+     *
+     * @param key 主机名或渠道
+     * @return true 获取成功
+     */
+    static bool tryAcquire(const std::string& key);
+};
+
+#endif //RATELIMITER_H
@@ -0,0 +1,67 @@
+//
+// Created by athbe on 2026/10/18.
+//
+
+#ifndef RESPONSECAPTURE_H
+#define RESPONSECAPTURE_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <cstdint>
+
+/*
+ * 接口响应录制文件
+ * --record 时把每个成功获取的原始响应（连同耗时和响应头）追加到文件，
+ * --replay 时读回这些响应，离线重放解析、匹配和渲染流程，结果不依赖网络和接口当前内容。
+ */
+class ResponseCapture {
+public:
+    // 一次录制的响应
+    struct Record {
+        std::string url;
+        int64_t fetchedAt = 0;   // 获取时间（Unix毫秒）
+        int64_t durationUs = 0;  // 请求耗时（含对冲请求，微秒）
+        int status = 0;          // HTTP状态码
+        std::string headers;     // 原始响应头
+        std::string body;        // 原始响应内容
+    };
+
+    /*
+     * 追加写入录制文件（线程安全），每条记录写完立即刷新，进程被杀死时最多丢失末尾一条
+     */
+    class Writer {
+    public:
+        /**
+         * @param path 录制文件路径，已存在时在末尾追加（先截掉末尾不完整的记录）
+         * @throws std::runtime_error 文件无法打开或不是录制文件
+         */
+        explicit Writer(const std::string& path);
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        /**
+         * @brief 追加一条记录
+         */
+        void append(const Record& record);
+
+    private:
+        std::mutex mutex_;
+        std::ofstream out_;
+    };
+
+    /**
+     * @brief 读取录制文件中的全部记录
+     *
+     * 末尾不完整的记录（录制时进程被中断）会被忽略。
+     *
+     * @param path 录制文件路径
+     * @return std::vector<Record> 按录制顺序排列的记录
+     * @throws std::runtime_error 文件无法打开或不是录制文件
+     */
+    static std::vector<Record> load(const std::string& path);
+};
+
+#endif //RESPONSECAPTURE_H
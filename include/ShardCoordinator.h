@@ -0,0 +1,115 @@
+//
+// Created by athbe on 2026/10/18.
+//
+
+#ifndef SHARDCOORDINATOR_H
+#define SHARDCOORDINATOR_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <utility>
+#include <chrono>
+#include <cstdint>
+
+/*
+ * 多实例分片协调（基于共享目录中的租约文件）
+ * 每个实例定期在 members/ 下写入心跳文件，存活实例按一致性哈希划分监控目标。
+ * 目标的归属由 leases/<目标>.lease 决定：在flock保护下读取并续期，
+ * 未过期的租约不会被其他实例抢占；实例退出或宕机后租约过期，由哈希环上的下一个实例接管。
+ * 每次易主递增租约的epoch，续期时epoch与获取时不同说明期间已被接管（隔离过期的持有者）。
+ */
+class ShardCoordinator {
+public:
+    struct Options {
+        std::string dir;                          // 共享协调目录
+        std::string instance_id;                  // 本实例ID，为空时使用 主机名-进程号
+        std::chrono::seconds lease{30};           // 租约有效期
+    };
+
+    explicit ShardCoordinator(Options options);
+
+    ShardCoordinator(const ShardCoordinator&) = delete;
+    ShardCoordinator& operator=(const ShardCoordinator&) = delete;
+
+    /**
+     * @brief 写入本实例的心跳并刷新存活实例列表和哈希环
+     */
+    void heartbeat();
+
+    /**
+     * @brief 按一致性哈希计算目标应归属的实例
+     *
+     * @param key 目标名称
+     * @return std::string 实例ID
+     */
+    std::string ownerOf(const std::string& key) const;
+
+    /**
+     * @brief 尝试持有目标的租约
+     *
+     * 已持有时续期；哈希环上归属其他实例时主动释放以便移交；
+     * 租约空闲或已过期且归属本实例时获取。
+     *
+     * @param key 目标名称
+     * @return true 本实例持有该目标
+     */
+    bool acquire(const std::string& key);
+
+    /**
+     * @brief 续期已持有的租约（不会获取新租约）
+     *
+     * 租约文件中的持有者和epoch都与本实例获取时一致才算仍然持有。
+     *
+     * @param key 目标名称
+     * @return true 租约仍由本实例持有
+     */
+    bool renew(const std::string& key);
+
+    /**
+     * @brief 释放所有租约并删除心跳文件（正常退出时调用）
+     */
+    void leave();
+
+    /**
+     * @brief 本实例ID
+     */
+    const std::string& instanceId() const { return options_.instance_id; }
+
+    /**
+     * @brief 租约有效期
+     */
+    std::chrono::seconds lease() const { return options_.lease; }
+
+    /**
+     * @brief 当前存活的实例数
+     */
+    size_t members() const { return members_.size(); }
+
+private:
+    enum class Mode {
+        Acquire,  // 获取或续期
+        Renew,    // 只续期
+        Release   // 释放
+    };
+
+    /**
+     * @brief 在flock保护下读取并更新租约文件
+     *
+     * @param key 目标名称
+     * @param mode 操作类型
+     * @return true 操作后本实例持有租约
+     */
+    bool updateLease(const std::string& key, Mode mode);
+
+    static int64_t nowMs();
+    static uint64_t hash(const std::string& text);
+
+    Options options_;
+    std::set<std::string> members_;                         // 存活实例
+    std::vector<std::pair<uint64_t, std::string>> ring_;    // 哈希环（虚拟节点，已排序）
+    std::map<std::string, uint64_t> held_;                  // 本实例持有的租约及获取时的epoch
+};
+
+#endif //SHARDCOORDINATOR_H
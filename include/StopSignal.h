@@ -0,0 +1,42 @@
+//
+// Created by athbe on 2026/10/18.
+//
+
+#ifndef STOPSIGNAL_H
+#define STOPSIGNAL_H
+
+#include <functional>
+#include <thread>
+
+/*
+ * SIGTERM / SIGINT 处理
+ * 信号处理函数只向管道写入信号编号，由独立线程读出后调用回调，回调中可以加锁和写日志。
+ * 收到第一个信号后恢复默认处理，再次收到信号时进程立即终止。
+ * 同一时间只能存在一个实例。
+ */
+class StopSignal {
+public:
+    /**
+     * @brief 安装信号处理并启动等待线程
+     *
+     * @param onSignal 收到信号时的回调（在等待线程中调用），参数为信号编号
+     */
+    explicit StopSignal(std::function<void(int)> onSignal);
+
+    /**
+     * @brief 恢复原来的信号处理并停止等待线程
+     */
+    ~StopSignal();
+
+    StopSignal(const StopSignal&) = delete;
+    StopSignal& operator=(const StopSignal&) = delete;
+
+private:
+    void wait();
+
+    std::function<void(int)> onSignal_;
+    int pipe_[2] = {-1, -1};
+    std::thread thread_;
+};
+
+#endif //STOPSIGNAL_H
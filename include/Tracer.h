@@ -0,0 +1,98 @@
+//
+// Created by athbe on 2026/10/18.
+//
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <nlohmann/json.hpp>
+#include <string>
+#include <cstdint>
+#include <curl/curl.h>
+
+/*
+ * 检查流程追踪
+ * 记录每次检查各阶段（网络各环节、JSON解析、匹配、渲染、投递）的耗时，
+ * 导出为 Chrome trace-event 格式，可在 chrome://tracing 或 Perfetto 中查看。
+ * 未启用时所有接口都是空操作。
+ */
+class Tracer {
+public:
+    /*
+     * 作用域内的耗时区间，析构时记录
+     */
+    class Span {
+    public:
+        Span(const char* name, const char* category = "check");
+        ~Span();
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+        /**
+         * @brief 为区间附加参数（显示在trace查看器的详情中）
+         *
+         * @param key 参数名
+         * @param value 参数值
+         */
+        void arg(const std::string& key, nlohmann::json value);
+
+    private:
+        const char* name_;
+        const char* category_;
+        int64_t startUs_ = 0;
+        bool active_;
+        nlohmann::json args_;
+    };
+
+    /**
+     * @brief 启用追踪
+     *
+     * @param path trace文件输出路径
+     */
+    static void enable(const std::string& path);
+
+    /**
+     * @brief 是否已启用追踪
+     */
+    static bool enabled();
+
+    /**
+     * @brief 当前时间戳（微秒，单调时钟）
+     */
+    static int64_t nowUs();
+
+    /**
+     * @brief 记录一个完整区间
+     *
+     * @param name 区间名称
+     * @param category 分类
+     * @param startUs 开始时间（微秒）
+     * @param durationUs 持续时间（微秒）
+     * @param args 附加参数
+     * @param lane 显示通道偏移（并发请求放在不同通道上）
+     */
+    static void addSpan(const std::string& name, const char* category,
+                        int64_t startUs, int64_t durationUs,
+                        nlohmann::json args = nullptr, int lane = 0);
+
+    /**
+     * @brief 根据curl_easy_getinfo的时间分解记录网络各阶段
+     *
+     * 依次生成 dns / connect / tls / wait / transfer 区间。
+     *
+     * @param curl 已完成的请求句柄
+     * @param startUs 请求开始时间（微秒）
+     * @param lane 显示通道偏移
+     */
+    static void recordCurlTimings(CURL* curl, int64_t startUs, int lane = 0);
+
+    /**
+     * @brief 将上次flush之后记录的事件追加到trace文件
+     *
+     * 文件为 trace-event 的JSON数组格式，第一次写入时创建；每次只序列化新事件。
+     */
+    static void flush();
+};
+
+#endif //TRACER_H
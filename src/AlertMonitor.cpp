@@ -2,11 +2,27 @@
 // Created by athbe on 2025/6/17.
 //
 #include "AlertMonitor.h"
+#include "Logger.h"
+#include "Tracer.h"
+#include "HostHealth.h"
+#include "CurlGlobal.h"
+#include "CheckScheduler.h"
+#include "ResponseCapture.h"
+#include "StopSignal.h"
 #include <fstream>
 #include <sstream>
-#include <iostream>
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <filesystem>
+#include <optional>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
 
 static size_t serverChanWriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
     size_t realsize = size * nmemb;
@@ -15,6 +31,48 @@ static size_t serverChanWriteCallback(void* contents, size_t size, size_t nmemb,
     return realsize;
 }
 
+// 状态目录锁：非分片模式下同一状态目录只允许一个进程使用（例如cron调用的上一次 --once 尚未结束），
+// 持有到对象销毁。分片模式下由租约和各目标的发件箱锁协调，不加锁
+class StateDirLock {
+public:
+    explicit StateDirLock(const AlertMonitor::Config& config) {
+        if (config.cluster.enabled) {
+            return;
+        }
+        std::filesystem::create_directories(config.state_dir);
+        std::string path = config.state_dir + "/.lock";
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            throw std::runtime_error("无法打开状态目录锁: " + path + ": " + std::strerror(errno));
+        }
+        if (::flock(fd_, LOCK_EX | LOCK_NB) != 0) {
+            int err = errno;
+            ::close(fd_);
+            fd_ = -1;
+            if (err != EWOULDBLOCK) {
+                throw std::runtime_error("无法锁定状态目录: " + path + ": " + std::strerror(err));
+            }
+            busy_ = true;
+        }
+    }
+
+    ~StateDirLock() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    StateDirLock(const StateDirLock&) = delete;
+    StateDirLock& operator=(const StateDirLock&) = delete;
+
+    // 另一个进程正在使用该状态目录
+    bool busy() const { return busy_; }
+
+private:
+    int fd_ = -1;
+    bool busy_ = false;
+};
+
 AlertMonitor::Config AlertMonitor::loadConfig(const std::string& config_path) {
     std::ifstream config_file(config_path);
     if (!config_file) {
@@ -30,24 +88,91 @@ AlertMonitor::Config AlertMonitor::loadConfig(const std::string& config_path) {
 
     Config config;
     config.check_interval = config_json["check_interval"];
-    config.target_url = config_json["target_url"];
+
+    // 读取监控目标（兼容只有 target_url 的旧配置）
+    if (config_json.contains("targets")) {
+        for (const auto& target_json : config_json["targets"]) {
+            Target target;
+            target.url = target_json["url"];
+            target.name = target_json.value("name", "target" + std::to_string(config.targets.size() + 1));
+
+            // 字段映射（JSON Pointer），未声明的字段使用蓝桥杯接口的默认值
+            ExtractionPlan::Mapping mapping;
+            if (target_json.contains("fields")) {
+                auto& fields_json = target_json["fields"];
+                mapping.list = fields_json.value("list", mapping.list);
+                mapping.id = fields_json.value("id", mapping.id);
+                mapping.title = fields_json.value("title", mapping.title);
+                mapping.time = fields_json.value("time", mapping.time);
+                mapping.category = fields_json.value("category", mapping.category);
+                mapping.summary = fields_json.value("summary", mapping.summary);
+            }
+            mapping.link = target_json.value("link", mapping.link);
+            try {
+                target.plan = ExtractionPlan(mapping);
+            } catch (const std::exception& e) {
+                throw std::runtime_error("目标 " + target.name + " 的字段映射无效: " + e.what());
+            }
+            config.targets.push_back(std::move(target));
+        }
+    } else {
+        Target target;
+        target.name = "default";
+        target.url = config_json["target_url"];
+        config.targets.push_back(std::move(target));
+    }
+    if (config.targets.empty()) {
+        throw std::runtime_error("配置中没有监控目标");
+    }
 
     // 读取关键词列表
     config.trigger_keywords = config_json["trigger_keywords"].get<std::vector<std::string>>();
+    config.match_fields = config_json.value("match_fields", config.match_fields);
+
+    // 读取触发事件类型
+    if (config_json.contains("trigger_events")) {
+        config.trigger_events.clear();
+        for (const auto& name : config_json["trigger_events"].get<std::vector<std::string>>()) {
+            if (name == "new") {
+                config.trigger_events.push_back(NoticeEvent::Kind::New);
+            } else if (name == "edited") {
+                config.trigger_events.push_back(NoticeEvent::Kind::Edited);
+            } else if (name == "removed") {
+                config.trigger_events.push_back(NoticeEvent::Kind::Removed);
+            } else {
+                throw std::runtime_error("未知的事件类型: " + name);
+            }
+        }
+    }
+    config.stop_after_alert = config_json.value("stop_after_alert", config.stop_after_alert);
 
     // 读取收件人列表
     config.recipients = config_json["recipients"].get<std::vector<std::string>>();
 
-    // 解析SMTP配置
+    // 解析SMTP配置：单个服务器对象，或带权重和连接数上限的中继列表
     auto& smtp_json = config_json["smtp"];
-    config.smtp.server = smtp_json["server"];
-    config.smtp.port = smtp_json["port"];
-    config.smtp.username = smtp_json["username"];
-    config.smtp.password = smtp_json["password"];
-
-    // 根据"security"字段设置SSL
-    std::string security = smtp_json["security"];
-    config.smtp.useSsl = (security == "ssl" || security == "tls");
+    auto relays = smtp_json.is_array() ? smtp_json : nlohmann::json::array({smtp_json});
+    for (const auto& relay_json : relays) {
+        MailSender::SmtpConfig relay;
+        relay.server = relay_json["server"];
+        relay.port = relay_json["port"];
+        relay.username = relay_json["username"];
+        relay.password = relay_json["password"];
+
+        // 根据"security"字段设置SSL
+        std::string security = relay_json.value("security", "");
+        relay.useSsl = (security == "ssl" || security == "tls");
+
+        relay.weight = relay_json.value("weight", relay.weight);
+        relay.maxConnections = relay_json.value("max_connections", relay.maxConnections);
+        if (relay.weight < 1 || relay.maxConnections < 1) {
+            throw std::runtime_error("SMTP中继 " + relay.server + " 的 weight 和 max_connections 必须大于0");
+        }
+        config.smtp.push_back(std::move(relay));
+    }
+    if (config.smtp.empty()) {
+        throw std::runtime_error("smtp 中至少需要配置一个中继");
+    }
 
     // 解析Server酱配置
     if (config_json.contains("server_chan")) {
@@ -57,103 +182,730 @@ AlertMonitor::Config AlertMonitor::loadConfig(const std::string& config_path) {
         config.server_chan.sendkey = server_chan_json.value("sendkey", "");
     }
 
+    // 日志配置（可选）
+    if (config_json.contains("log")) {
+        auto& log_json = config_json["log"];
+        config.log.level = Logger::parseLevel(log_json.value("level", "info"));
+        config.log.format = log_json.value("format", "text") == "json" ? Logger::Format::Json : Logger::Format::Text;
+        config.log.rate_limit_seconds = log_json.value("rate_limit_seconds", config.log.rate_limit_seconds);
+    }
+
+    // 追踪配置（可选）
+    if (config_json.contains("trace")) {
+        auto& trace_json = config_json["trace"];
+        if (trace_json.value("enabled", false)) {
+            config.trace_path = trace_json.value("path", "trace.json");
+        }
+    }
+
+    // 限流配置（可选）
+    if (config_json.contains("rate_limits")) {
+        for (const auto& [key, limit_json] : config_json["rate_limits"].items()) {
+            RateLimiter::Limit limit;
+            limit.rate = limit_json.value("rate", 0.0);
+            limit.burst = limit_json.value("burst", 1.0);
+            config.rate_limits[key] = limit;
+        }
+    }
+
+    // 状态目录（可选）
+    config.state_dir = config_json.value("state_dir", config.state_dir);
+
+    // 控制接口（可选）
+    if (config_json.contains("control")) {
+        auto& control_json = config_json["control"];
+        config.control.socket_path = control_json.value("socket", "");
+        config.control.http_bind = control_json.value("http_bind", config.control.http_bind);
+        config.control.http_port = control_json.value("http_port", 0);
+    }
+
+    // 多实例分片（可选）
+    config.cluster.dir = config.state_dir + "/cluster";
+    if (config_json.contains("cluster")) {
+        auto& cluster_json = config_json["cluster"];
+        config.cluster.enabled = cluster_json.value("enabled", false);
+        config.cluster.dir = cluster_json.value("dir", config.cluster.dir);
+        config.cluster.instance_id = cluster_json.value("instance_id", "");
+        config.cluster.lease_seconds = cluster_json.value("lease_seconds", config.cluster.lease_seconds);
+        if (config.cluster.lease_seconds <= 0) {
+            throw std::runtime_error("cluster.lease_seconds 必须大于0");
+        }
+    }
+
     return config;
 }
 
-void AlertMonitor::run(const Config& config) {
-    std::cout << "启动监控服务..." << std::endl;
-    std::cout << "监控URL: " << config.target_url << std::endl;
-    std::cout << "检查间隔: " << config.check_interval << "秒" << std::endl;
+void AlertMonitor::setup(const Config& config) {
+    Logger::configure(config.log);
+    Tracer::enable(config.trace_path);
+    for (const auto& [key, limit] : config.rate_limits) {
+        RateLimiter::configure(key, limit);
+    }
+    // 兼容只写服务器的邮件限流键（smtp:服务器），应用到该服务器的每个中继
+    for (const auto& relay : config.smtp) {
+        std::string key = "smtp:" + relay.server + ":" + std::to_string(relay.port);
+        auto legacy = config.rate_limits.find("smtp:" + relay.server);
+        if (legacy != config.rate_limits.end() && config.rate_limits.count(key) == 0) {
+            RateLimiter::configure(key, legacy->second);
+        }
+    }
+}
+
+const char* AlertMonitor::checkResultName(CheckResult result) {
+    switch (result) {
+        case CheckResult::Unchanged: return "unchanged";
+        case CheckResult::Changed: return "changed";
+        case CheckResult::Triggered: return "triggered";
+        case CheckResult::FetchFailed: return "fetch_failed";
+        case CheckResult::DeliveryFailed: return "delivery_failed";
+        case CheckResult::LeaseLost: return "lease_lost";
+    }
+    return "unknown";
+}
+
+std::string AlertMonitor::snapshotPath(const Config& config, const Target& target) {
+    if (config.cluster.enabled) {
+        // 分片模式下快照放在共享目录，接管的实例从同一份快照继续
+        return config.cluster.dir + "/targets/" + target.name + "/snapshot.bin";
+    }
+    return config.state_dir + "/snapshots/" + target.name + ".bin";
+}
+
+AlertMonitor::State::State(const Config& config)
+    : archiveDir(config.cluster.enabled ? config.cluster.dir + "/targets" : config.state_dir + "/archive") {
+    if (config.cluster.enabled) {
+        ShardCoordinator::Options options;
+        options.dir = config.cluster.dir;
+        options.instance_id = config.cluster.instance_id;
+        options.lease = std::chrono::seconds(config.cluster.lease_seconds);
+        coordinator = std::make_unique<ShardCoordinator>(options);
+        return;
+    }
+
+    outbox = std::make_unique<Outbox>(config.state_dir + "/outbox.log");
+    for (const auto& target : config.targets) {
+        if (snapshots[target.name].load(snapshotPath(config, target))) {
+            Logger::debug() << "[" << target.name << "] 已恢复快照，共 " << snapshots[target.name].size() << " 条通知";
+        }
+    }
+}
+
+NoticeArchive& AlertMonitor::State::archive(const std::string& target) {
+    if (!coordinator) {
+        if (!archiveHandle) {
+            archiveHandle = std::make_unique<NoticeArchive>(archiveDir);
+        }
+        return *archiveHandle;
+    }
+
+    auto& handle = targetArchives[target];
+    if (!handle) {
+        handle = std::make_unique<NoticeArchive>(archiveDir + "/" + target + "/archive");
+    }
+    return *handle;
+}
+
+Outbox& AlertMonitor::State::outboxFor(const std::string& target) {
+    if (!coordinator) {
+        return *outbox;
+    }
+    auto it = targetOutboxes.find(target);
+    if (it == targetOutboxes.end()) {
+        throw std::logic_error("目标未由本实例负责: " + target);
+    }
+    return *it->second;
+}
+
+bool AlertMonitor::State::owns(const std::string& target) const {
+    return !coordinator || targetOutboxes.count(target) > 0;
+}
+
+bool AlertMonitor::State::renew(const std::string& target) {
+    return !coordinator || coordinator->renew(target);
+}
+
+void AlertMonitor::State::adopt(const Config& config, const Target& target) {
+    // 重新读取共享目录中的状态：其他实例可能在此期间写入过
+    NoticeSnapshot snapshot;
+    snapshot.load(snapshotPath(config, target));
+    snapshots[target.name] = std::move(snapshot);
+    targetOutboxes[target.name] = std::make_unique<Outbox>(
+        config.cluster.dir + "/targets/" + target.name + "/outbox.log");
+}
+
+void AlertMonitor::State::drop(const std::string& target) {
+    targetOutboxes.erase(target);
+    targetArchives.erase(target);
+    snapshots.erase(target);
+}
+
+std::vector<const AlertMonitor::Target*> AlertMonitor::claimTargets(const Config& config, State& state) {
+    std::vector<const Target*> gained;
+    state.coordinator->heartbeat();
+
+    for (const auto& target : config.targets) {
+        bool had = state.owns(target.name);
+        bool holds = false;
+        try {
+            holds = state.coordinator->acquire(target.name);
+        } catch (const std::exception& e) {
+            Logger::error() << "[" << target.name << "] 租约操作失败: " << e.what();
+        }
+
+        if (holds && !had) {
+            try {
+                state.adopt(config, target);
+            } catch (const std::exception& e) {
+                // 例如原持有者仍未关闭发件箱：保留租约，下次续期时再尝试接管
+                Logger::error() << "[" << target.name << "] 无法接管目标状态: " << e.what();
+                state.drop(target.name);
+                continue;
+            }
+            Logger::info() << "[" << target.name << "] 接管目标（实例 " << state.coordinator->instanceId() << "）";
+
+            // 补发前一个持有者未完成的投递
+            auto unfinished = state.outboxFor(target.name).pending();
+            if (!unfinished.empty()) {
+                Logger::info() << "[" << target.name << "] 重放发件箱中 " << unfinished.size() << " 条未完成的通知";
+                dispatchOutbox(config, state, target.name);
+            }
+            gained.push_back(&target);
+        } else if (!holds && had) {
+            Logger::info() << "[" << target.name << "] 目标已移交给 " << state.coordinator->ownerOf(target.name);
+            state.drop(target.name);
+        }
+    }
+    return gained;
+}
+
+int AlertMonitor::run(const Config& config) {
+    setup(config);
+
+    StateDirLock stateLock(config);
+    if (stateLock.busy()) {
+        Logger::error() << "另一个进程正在使用状态目录: " << config.state_dir;
+        return kExitLocked;
+    }
+
+    Logger::info() << "启动监控服务...";
+    for (const auto& target : config.targets) {
+        Logger::info() << "监控目标 [" << target.name << "]: " << target.url;
+    }
+    Logger::info() << "检查间隔: " << config.check_interval << "秒";
 
     // 输出关键词列表
-    std::cout << "触发关键词: ";
-    for (const auto& keyword : config.trigger_keywords) {
-        std::cout << "\"" << keyword << "\" ";
+    {
+        auto line = Logger::info();
+        line << "触发关键词: ";
+        for (const auto& keyword : config.trigger_keywords) {
+            line << "\"" << keyword << "\" ";
+        }
     }
-    std::cout << std::endl;
 
     // 输出收件人列表
-    std::cout << "收件人: ";
-    for (const auto& recipient : config.recipients) {
-        std::cout << recipient << "; ";
+    {
+        auto line = Logger::info();
+        line << "收件人: ";
+        for (const auto& recipient : config.recipients) {
+            line << recipient << "; ";
+        }
     }
-    std::cout << std::endl;
 
     // 输出Server酱状态
     if (config.server_chan.enabled) {
-        std::cout << "Server酱推送: 已启用" << std::endl;
+        Logger::info() << "Server酱推送: 已启用";
     } else {
-        std::cout << "Server酱推送: 已禁用" << std::endl;
+        Logger::info() << "Server酱推送: 已禁用";
+    }
+
+    // 打开发件箱并恢复快照，重放上次未完成的投递
+    State state(config);
+    if (state.coordinator) {
+        Logger::info() << "分片模式: 实例 " << state.coordinator->instanceId()
+                       << "，租约 " << config.cluster.lease_seconds << " 秒";
+    } else if (!state.outbox->pending().empty()) {
+        Logger::info() << "重放发件箱中 " << state.outbox->pending().size() << " 条未完成的通知";
+        dispatchOutbox(config, state, "");
+    }
+
+    // 立即检查请求：控制接口线程提交，主循环在等待期间执行
+    std::vector<std::string> targetNames;
+    for (const auto& target : config.targets) {
+        targetNames.push_back(target.name);
+    }
+    CheckScheduler scheduler(targetNames);
+
+    // SIGTERM / SIGINT：唤醒主循环，当前检查完成后退出，释放租约并写完日志
+    StopSignal stopSignal([&scheduler](int signo) {
+        Logger::info() << "收到信号 " << signo << "，正在停止...";
+        scheduler.stop();
+    });
+
+    std::unique_ptr<ControlServer> control;
+    if (!config.control.socket_path.empty() || config.control.http_port > 0) {
+        std::string instance = state.coordinator ? state.coordinator->instanceId() : "";
+        control = std::make_unique<ControlServer>(config.control,
+            [&scheduler, &targetNames, instance](const std::string& command, const std::string& target) -> nlohmann::json {
+                if (command == "status") {
+                    auto status = scheduler.status();
+                    if (!instance.empty()) {
+                        status["instance"] = instance;
+                    }
+                    return status;
+                }
+                if (command != "check") {
+                    return {{"error", "unknown command: " + command}};
+                }
+                if (!target.empty()) {
+                    auto submit = scheduler.request(target);
+                    if (submit == CheckScheduler::Submit::Unknown) {
+                        return {{"error", "unknown target: " + target}};
+                    }
+                    return {{"target", target}, {"status", CheckScheduler::submitName(submit)}};
+                }
+                nlohmann::json results = nlohmann::json::object();
+                for (const auto& name : targetNames) {
+                    results[name] = CheckScheduler::submitName(scheduler.request(name));
+                }
+                return {{"targets", results}};
+            });
+        if (!config.control.socket_path.empty()) {
+            Logger::info() << "控制套接字: " << config.control.socket_path;
+        }
+        if (config.control.http_port > 0) {
+            Logger::info() << "控制接口: http://" << config.control.http_bind << ":" << config.control.http_port;
+        }
     }
 
+    // 分片模式下等待期间也要按租约的1/3周期续期，并及时接管过期的目标
+    using Clock = std::chrono::steady_clock;
+    const auto tick = std::chrono::seconds(
+        state.coordinator ? std::clamp(config.cluster.lease_seconds / 3, 1, 10) : 10);
+
     bool alertTriggered = false;
     int checkCount = 0;
 
-    while (!alertTriggered) {
-        checkCount++;
-        std::cout << "\n=== 检查 #" << checkCount << " ===" << std::endl;
-        std::cout << "获取JSON数据..." << std::endl;
+    auto check = [&](const Target& target) {
+        scheduler.begin(target.name);
+        auto start = Clock::now();
+        CheckResult result = checkTarget(config, target, state);
+        scheduler.finish(target.name, checkResultName(result),
+                         std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start));
 
-        try {
-            auto jsonData = JsonFetcher::fetchFromUrl(config.target_url);
+        bool triggered = result == CheckResult::Triggered || result == CheckResult::DeliveryFailed;
+        if (triggered && config.stop_after_alert) {
+            alertTriggered = true;
+        }
+    };
 
-            if (jsonData) {
-                std::cout << "成功获取JSON数据" << std::endl;
+    auto claim = [&]() {
+        auto gained = claimTargets(config, state);
+        for (const auto& target : config.targets) {
+            scheduler.setOwned(target.name, state.owns(target.name));
+        }
+        return gained;
+    };
 
-                // 检查所有匹配关键词的通知
-                auto triggeredItems = checkForTrigger(jsonData.value(), config.trigger_keywords);
+    while (!alertTriggered && !scheduler.stopped()) {
+        checkCount++;
+        Logger::info() << "=== 检查 #" << checkCount << " ===";
 
-                if (!triggeredItems.empty()) {
-                    std::cout << "检测到 " << triggeredItems.size()
-                              << " 条包含所有关键词的通知" << std::endl;
+        if (state.coordinator) {
+            claim();
+        }
+        for (const auto& target : config.targets) {
+            if (scheduler.stopped()) {
+                break;
+            }
+            if (state.owns(target.name)) {
+                check(target);
+            }
+        }
+        Tracer::flush();
 
-                    // 发送邮件
-                    std::string subject = "蓝桥杯大赛通知提醒";
-                    std::string content = generateEmailContent(triggeredItems, config.trigger_keywords);
+        if (alertTriggered || scheduler.stopped()) {
+            break;
+        }
 
-                    for (const auto& recipient : config.recipients) {
-                        std::cout << "发送邮件到: " << recipient << std::endl;
-                        if (MailSender::send(config.smtp, recipient, subject, content)) {
-                            std::cout << "邮件发送成功" << std::endl;
-                        } else {
-                            std::cerr << "邮件发送失败" << std::endl;
-                        }
-                    }
+        // 等待下一次检查，期间随时响应立即检查请求
+        Logger::info() << "等待下一次检查...";
+        auto waitStart = Clock::now();
+        auto nextCycle = waitStart + std::chrono::seconds(config.check_interval);
+        auto nextTick = waitStart + tick;
+        long minutesLogged = 0;
+
+        while (!alertTriggered && !scheduler.stopped() && Clock::now() < nextCycle) {
+            if (auto requested = scheduler.waitUntil(std::min(nextCycle, nextTick))) {
+                auto it = std::find_if(config.targets.begin(), config.targets.end(),
+                                       [&](const Target& target) { return target.name == *requested; });
+                if (it != config.targets.end() && state.owns(it->name)) {
+                    Logger::info() << "[" << it->name << "] 收到立即检查请求";
+                    check(*it);
+                    Tracer::flush();
+                }
+            }
+            // 处理完请求后同样检查周期：持续的立即检查请求不能推迟心跳、续期和接管
+            if (alertTriggered || scheduler.stopped() || Clock::now() < nextTick) {
+                continue;
+            }
+            nextTick = Clock::now() + tick;
 
-                    // 发送Server酱推送
-                    if (config.server_chan.enabled) {
-                        std::cout << "发送Server酱推送..." << std::endl;
-                        if (sendServerChan(config.server_chan, triggeredItems, config.trigger_keywords)) {
-                            std::cout << "Server酱推送成功" << std::endl;
-                        } else {
-                            std::cerr << "Server酱推送失败" << std::endl;
-                        }
-                    }
+            long minutes = std::chrono::duration_cast<std::chrono::minutes>(Clock::now() - waitStart).count();
+            if (minutes > minutesLogged) {
+                minutesLogged = minutes;
+                Logger::info() << "已等待 " << minutes << " 分钟...";
+            }
 
-                    alertTriggered = true; // 发送后停止监控
-                } else {
-                    std::cout << "未检测到包含所有关键词的通知" << std::endl;
+            // 新接管的目标立即检查一次
+            if (state.coordinator) {
+                for (const Target* target : claim()) {
+                    if (scheduler.stopped()) {
+                        break;
+                    }
+                    check(*target);
                 }
-            } else {
-                std::cerr << "获取JSON数据失败: " << JsonFetcher::getLastError() << std::endl;
             }
-        } catch (const std::exception& e) {
-            std::cerr << "发生异常: " << e.what() << std::endl;
         }
+    }
+
+    control.reset();
+    if (state.coordinator) {
+        state.coordinator->leave();
+    }
+    Logger::info() << "监控服务已停止";
+    return kExitNoAlert;
+}
+
+int AlertMonitor::runOnce(const Config& config) {
+    setup(config);
+
+    // 上一次调用尚未结束时直接退出，避免两个进程投递同一条提醒
+    StateDirLock stateLock(config);
+    if (stateLock.busy()) {
+        Logger::warn() << "上一次检查仍在运行（状态目录已被锁定）: " << config.state_dir;
+        return kExitLocked;
+    }
+
+    State state(config);
+    bool deliveryFailed = false;
+    bool fetchFailed = false;
+    bool triggered = false;
+
+    // 收到 SIGTERM / SIGINT 时不再开始新的检查，释放租约后正常退出
+    std::atomic<bool> stopping{false};
+    StopSignal stopSignal([&stopping](int signo) {
+        Logger::info() << "收到信号 " << signo << "，当前目标检查完成后退出";
+        stopping.store(true);
+    });
+
+    // 先补发上次未完成的投递（分片模式下在接管目标时补发）
+    if (state.coordinator) {
+        claimTargets(config, state);
+    } else if (!state.outbox->pending().empty()) {
+        Logger::info() << "重放发件箱中 " << state.outbox->pending().size() << " 条未完成的通知";
+        deliveryFailed = dispatchOutbox(config, state, "") > 0;
+        triggered = !deliveryFailed;
+    }
+
+    for (const auto& target : config.targets) {
+        if (stopping.load()) {
+            break;
+        }
+        if (!state.owns(target.name)) {
+            continue;
+        }
+        switch (checkTarget(config, target, state)) {
+            case CheckResult::Triggered:
+                triggered = true;
+                break;
+            case CheckResult::DeliveryFailed:
+                deliveryFailed = true;
+                break;
+            case CheckResult::FetchFailed:
+                fetchFailed = true;
+                break;
+            case CheckResult::Unchanged:
+            case CheckResult::Changed:
+            case CheckResult::LeaseLost:
+                break;
+        }
+    }
+    Tracer::flush();
+
+    // 释放租约和心跳，下一次调用（进程号不同）无需等待租约过期
+    if (state.coordinator) {
+        state.coordinator->leave();
+    }
+
+    if (deliveryFailed) return kExitDeliveryFailed;
+    if (fetchFailed) return kExitFetchFailed;
+    if (triggered) return kExitAlert;
+    return kExitNoAlert;
+}
 
-        // 如果不是最后一次检查，等待指定时间
-        if (!alertTriggered) {
-            std::cout << "等待下一次检查..." << std::endl;
-            for (int i = 0; i < config.check_interval; i += 10) {
-                if (i % 60 == 0 && i > 0) {
-                    std::cout << "已等待 " << i / 60 << " 分钟..." << std::endl;
+int AlertMonitor::replay(const Config& config, const std::string& path, int iterations) {
+    using Clock = std::chrono::steady_clock;
+
+    auto records = ResponseCapture::load(path);
+    if (records.empty()) {
+        Logger::error() << "录制文件中没有响应: " << path;
+        return kExitError;
+    }
+
+    // 录制时的获取耗时包含所有响应；非200响应只统计状态码，不参与处理
+    const size_t recordedCount = records.size();
+    int64_t recordedUs = 0;
+    int64_t slowestUs = 0;
+    std::map<int, size_t> skippedStatus;
+    for (const auto& record : records) {
+        recordedUs += record.durationUs;
+        slowestUs = std::max(slowestUs, record.durationUs);
+        if (record.status != 200) {
+            skippedStatus[record.status]++;
+        }
+    }
+    records.erase(std::remove_if(records.begin(), records.end(),
+                                 [](const ResponseCapture::Record& record) { return record.status != 200; }),
+                  records.end());
+    if (records.empty()) {
+        Logger::error() << "录制文件中没有HTTP 200响应: " << path;
+        return kExitError;
+    }
+
+    // 每个响应使用URL对应目标的提取计划
+    const ExtractionPlan defaultPlan;
+    std::vector<const ExtractionPlan*> plans;
+    size_t unmatched = 0;
+    for (const auto& record : records) {
+        auto it = std::find_if(config.targets.begin(), config.targets.end(),
+                               [&](const Target& target) { return target.url == record.url; });
+        if (it == config.targets.end()) {
+            unmatched++;
+        }
+        plans.push_back(it != config.targets.end() ? &it->plan : &defaultPlan);
+    }
+    if (unmatched > 0) {
+        Logger::warn() << unmatched << " 个响应的URL不属于任何配置的目标，使用默认提取计划";
+    }
+
+    enum Stage { Parse, Extract, Match, Render, StageCount };
+    static const char* stageNames[StageCount] = {"parse", "extract", "match", "render"};
+    std::array<Clock::duration, StageCount> stageTime{};
+
+    size_t items = 0;
+    size_t matched = 0;
+    size_t bytes = 0;
+    size_t failed = 0;
+    size_t delivered = 0;      // 空投递器收到的条目数
+    size_t renderedBytes = 0;  // 渲染结果的总字节数，防止渲染被优化掉
+
+    // 空投递器：只统计，不发送
+    auto deliver = [&](const std::string& body) {
+        delivered++;
+        renderedBytes += body.size();
+    };
+
+    CycleArena arena;
+    std::vector<NoticeEvent> events;
+    for (int round = 0; round < iterations; ++round) {
+        for (size_t i = 0; i < records.size(); ++i) {
+            const auto& record = records[i];
+            CycleArena::Scope arenaScope(arena);
+
+            auto t0 = Clock::now();
+            std::optional<ArenaJson> document;
+            try {
+                document.emplace(ArenaJson::parse(record.body));
+            } catch (const nlohmann::json::parse_error&) {
+                failed++;
+                continue;
+            }
+            auto t1 = Clock::now();
+            std::vector<Notice> notices = plans[i]->extract(*document);
+            document.reset();
+            auto t2 = Clock::now();
+
+            events.clear();
+            for (auto& notice : notices) {
+                events.push_back({NoticeEvent::Kind::New, std::move(notice)});
+            }
+            auto triggered = checkForTrigger(events, config);
+            auto t3 = Clock::now();
+
+            if (!triggered.empty()) {
+                for (size_t r = 0; r < config.recipients.size(); ++r) {
+                    deliver(generateEmailContent(triggered, config.trigger_keywords));
+                }
+                if (config.server_chan.enabled) {
+                    deliver(generateServerChanContent(triggered, config.trigger_keywords));
                 }
-                std::this_thread::sleep_for(std::chrono::seconds(10));
             }
+            auto t4 = Clock::now();
+
+            stageTime[Parse] += t1 - t0;
+            stageTime[Extract] += t2 - t1;
+            stageTime[Match] += t3 - t2;
+            stageTime[Render] += t4 - t3;
+            items += events.size();
+            matched += triggered.size();
+            bytes += record.body.size();
         }
     }
 
-    std::cout << "\n监控服务已停止" << std::endl;
+    auto ms = [](Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    Clock::duration total{};
+    for (auto d : stageTime) {
+        total += d;
+    }
+    double seconds = std::max(std::chrono::duration<double>(total).count(), 1e-9);
+    size_t responses = records.size() * static_cast<size_t>(iterations) - failed;
+
+    std::printf("重放 %zu 个响应 × %d 轮（%.1f MB），共 %zu 条通知，命中 %zu 条，空投递 %zu 条（%zu 字节）\n",
+                records.size(), iterations, static_cast<double>(bytes) / 1e6, items, matched, delivered, renderedBytes);
+    if (!skippedStatus.empty()) {
+        std::printf("另有 %zu 个非200响应未参与处理：", recordedCount - records.size());
+        for (const auto& [status, count] : skippedStatus) {
+            std::printf(" HTTP %d × %zu", status, count);
+        }
+        std::printf("\n");
+    }
+    if (failed > 0) {
+        std::printf("其中 %zu 个响应不是有效的JSON，已跳过\n", failed);
+    }
+    std::printf("总耗时 %.2f ms，%.0f 条通知/秒，%.0f 个响应/秒，%.1f MB/s\n",
+                ms(total), static_cast<double>(items) / seconds, static_cast<double>(responses) / seconds,
+                static_cast<double>(bytes) / 1e6 / seconds);
+    std::printf("%-10s %12s %14s %8s\n", "阶段", "总耗时(ms)", "每响应(us)", "占比");
+    for (int stage = 0; stage < StageCount; ++stage) {
+        std::printf("%-10s %12.2f %14.2f %7.1f%%\n", stageNames[stage], ms(stageTime[stage]),
+                    responses > 0 ? ms(stageTime[stage]) * 1000.0 / static_cast<double>(responses) : 0.0,
+                    total.count() > 0 ? 100.0 * static_cast<double>(stageTime[stage].count()) / static_cast<double>(total.count()) : 0.0);
+    }
+    std::printf("录制时的获取耗时：平均 %.1f ms，最慢 %.1f ms\n",
+                static_cast<double>(recordedUs) / 1000.0 / static_cast<double>(recordedCount),
+                static_cast<double>(slowestUs) / 1000.0);
+    return kExitNoAlert;
+}
+
+AlertMonitor::CheckResult AlertMonitor::checkTarget(
+    const Config& config,
+    const Target& target,
+    State& state
+) {
+    Logger::info() << "[" << target.name << "] 获取JSON数据...";
+    NoticeSnapshot& snapshot = state.snapshots[target.name];
+
+    // 失去租约时丢弃本地状态，由接管的实例从共享目录继续
+    auto leaseLost = [&]() {
+        Logger::warn() << "[" << target.name << "] 租约已失效，放弃本次检查";
+        state.drop(target.name);
+        return CheckResult::LeaseLost;
+    };
+
+    try {
+        // 本次检查的JSON解析结果都分配在内存池中，离开作用域时一次性回收
+        CycleArena::Scope arenaScope(state.arena);
+        Tracer::Span checkSpan("check");
+        checkSpan.arg("target", target.name);
+
+        if (!state.renew(target.name)) {
+            return leaseLost();
+        }
+
+        // 按主机限流
+        auto waited = RateLimiter::acquire(HostHealth::hostOf(target.url));
+        if (waited.count() > 0) {
+            Logger::debug() << "[" << target.name << "] 限流等待 " << waited.count() << " ms";
+        }
+
+        if (!JsonFetcher::fetchBody(target.url, state.body)) {
+            Logger::error() << "[" << target.name << "] 获取JSON数据失败: " << JsonFetcher::getLastError();
+            return CheckResult::FetchFailed;
+        }
+
+        // 解析到内存池并按提取计划取出通知，JSON在离开该块时销毁
+        std::vector<Notice> notices;
+        {
+            Tracer::Span span("parse");
+            try {
+                ArenaJson document = ArenaJson::parse(state.body);
+                notices = target.plan.extract(document);
+            } catch (const nlohmann::json::parse_error& e) {
+                span.arg("error", e.what());
+                Logger::error() << "[" << target.name << "] 获取JSON数据失败: JSON parse error: " << e.what();
+                return CheckResult::FetchFailed;
+            }
+            span.arg("notices", notices.size());
+        }
+        Logger::info() << "[" << target.name << "] 成功获取JSON数据";
+
+        // 与上次快照比较，只处理变化的通知；快照在变化写入发件箱之后才更新
+        std::vector<NoticeEvent> events;
+        {
+            Tracer::Span span("diff");
+            events = snapshot.diff(notices);
+            span.arg("events", events.size());
+        }
+        if (events.empty()) {
+            Logger::info() << "[" << target.name << "] 通知列表没有变化";
+            return CheckResult::Unchanged;
+        }
+        Logger::info() << "[" << target.name << "] 检测到 " << events.size() << " 条变化";
+
+        // 检查所有命中规则的事件
+        std::vector<NoticeEvent> triggered;
+        {
+            Tracer::Span span("match");
+            triggered = checkForTrigger(events, config);
+            span.arg("matched", triggered.size());
+        }
+
+        // 写入共享状态前确认仍持有租约（获取数据期间租约可能过期）
+        if (!state.renew(target.name)) {
+            return leaseLost();
+        }
+
+        // 先写入发件箱并落盘，再更新并保存快照；此前任何一步失败，下次检查仍会得到同样的变化
+        Outbox& outbox = state.outboxFor(target.name);
+        size_t queued = triggered.empty() ? 0 : enqueueNotifications(config, outbox, triggered);
+        snapshot.apply(notices);
+        snapshot.save(snapshotPath(config, target));
+
+        // 新增和编辑后的版本写入归档；归档只用于查询，写入失败不影响提醒
+        try {
+            Tracer::Span span("archive");
+            for (const auto& event : events) {
+                if (event.kind != NoticeEvent::Kind::Removed) {
+                    state.archive(target.name).append(event.notice);
+                }
+            }
+        } catch (const std::exception& e) {
+            Logger::warn() << "[" << target.name << "] 写入通知归档失败: " << e.what();
+        }
+
+        if (triggered.empty()) {
+            Logger::info() << "[" << target.name << "] 未检测到包含所有关键词的通知";
+            return CheckResult::Changed;
+        }
+        Logger::info() << "[" << target.name << "] 检测到 " << triggered.size() << " 条包含所有关键词的通知";
+        if (queued == 0 && outbox.pending().empty()) {
+            Logger::info() << "这些通知此前已投递，跳过发送";
+            return CheckResult::Changed;
+        }
+
+        size_t failed = dispatchOutbox(config, state, target.name);
+        if (!state.renew(target.name)) {
+            return leaseLost();
+        }
+        if (failed > 0) {
+            Logger::error() << failed << " 条通知投递失败，将在下次启动时重试";
+            return CheckResult::DeliveryFailed;
+        }
+        return CheckResult::Triggered;
+    } catch (const std::exception& e) {
+        Logger::error() << "[" << target.name << "] 发生异常: " << e.what();
+        return CheckResult::FetchFailed;
+    }
 }
 
 // 检查标题是否包含所有关键词
@@ -187,37 +939,45 @@ bool AlertMonitor::containsAllKeywords(
     return true;
 }
 
-std::vector<nlohmann::json> AlertMonitor::checkForTrigger(
-    const nlohmann::json& json_data,
-    const std::vector<std::string>& trigger_keywords
+std::vector<NoticeEvent> AlertMonitor::checkForTrigger(
+    const std::vector<NoticeEvent>& events,
+    const Config& config
 ) {
-    std::vector<nlohmann::json> matchedItems;
-
-    // 检查数据是否包含datalist数组
-    if (!json_data.contains("datalist") || !json_data["datalist"].is_array()) {
-        return matchedItems;
-    }
-
-    // 遍历所有新闻项，收集匹配所有关键词的项
-    for (const auto& item : json_data["datalist"]) {
-        if (item.contains("title") && item["title"].is_string()) {
-            std::string title = item["title"].get<std::string>();
+    std::vector<NoticeEvent> matched;
+    std::string text;
+
+    for (const auto& event : events) {
+        // 只处理配置的事件类型
+        if (std::find(config.trigger_events.begin(), config.trigger_events.end(), event.kind)
+            == config.trigger_events.end()) {
+            continue;
+        }
 
-            // 检查标题是否包含所有关键词
-            if (containsAllKeywords(title, trigger_keywords)) {
-                matchedItems.push_back(item);
+        // 拼接参与匹配的字段（复用缓冲区）
+        text.clear();
+        for (const auto& field : config.match_fields) {
+            if (field == "title") {
+                text += event.notice.title;
+            } else if (field == "synopsis") {
+                text += event.notice.synopsis;
+            } else if (field == "programa") {
+                text += event.notice.programaName;
             }
+            text += '\n';
+        }
+
+        // 检查是否包含所有关键词
+        if (containsAllKeywords(text, config.trigger_keywords)) {
+            matched.push_back(event);
         }
     }
 
     // 按创建时间排序（最新在前）
-    std::sort(matchedItems.begin(), matchedItems.end(), [](const auto& a, const auto& b) {
-        std::string timeA = a.value("creatTime", "");
-        std::string timeB = b.value("creatTime", "");
-        return timeA > timeB; // 降序排序
+    std::sort(matched.begin(), matched.end(), [](const auto& a, const auto& b) {
+        return a.notice.creatTime > b.notice.creatTime; // 降序排序
     });
 
-    return matchedItems;
+    return matched;
 }
 
 std::string AlertMonitor::utcToBeijingTime(const std::string& utc_time) {
@@ -227,7 +987,8 @@ std::string AlertMonitor::utcToBeijingTime(const std::string& utc_time) {
     ss >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S");
 
     if (ss.fail()) {
-        return "时间解析失败";
+        // 其他站点的时间格式无法转换时原样显示
+        return utc_time;
     }
 
     // 转换为time_t (UTC时间)
@@ -248,7 +1009,7 @@ std::string AlertMonitor::utcToBeijingTime(const std::string& utc_time) {
 }
 
 std::string AlertMonitor::generateEmailContent(
-    const std::vector<nlohmann::json>& news_items,
+    const std::vector<NoticeEvent>& events,
     const std::vector<std::string>& trigger_keywords
 ) {
     std::ostringstream content;
@@ -264,34 +1025,41 @@ std::string AlertMonitor::generateEmailContent(
     content << "）:\n\n";
 
     int count = 1;
-    for (const auto& item : news_items) {
+    for (const auto& event : events) {
+        const Notice& notice = event.notice;
         content << "通知 #" << count++ << ":\n";
         content << "----------------------------\n";
 
+        // 变化类型（新通知不标注）
+        if (event.kind == NoticeEvent::Kind::Edited) {
+            content << "状态: 内容已更新\n";
+        } else if (event.kind == NoticeEvent::Kind::Removed) {
+            content << "状态: 已删除\n";
+        }
+
         // 标题
-        if (item.contains("title") && item["title"].is_string()) {
-            content << "标题: " << item["title"].get<std::string>() << "\n";
+        if (!notice.title.empty()) {
+            content << "标题: " << notice.title << "\n";
         }
 
         // 创建时间
-        if (item.contains("creatTime") && item["creatTime"].is_string()) {
-            content << "发布时间: " << utcToBeijingTime(item["creatTime"].get<std::string>()) << "\n";
+        if (!notice.creatTime.empty()) {
+            content << "发布时间: " << utcToBeijingTime(notice.creatTime) << "\n";
         }
 
         // 栏目名称
-        if (item.contains("programaName") && item["programaName"].is_string()) {
-            content << "栏目: " << item["programaName"].get<std::string>() << "\n";
+        if (!notice.programaName.empty()) {
+            content << "栏目: " << notice.programaName << "\n";
         }
 
         // 简介
-        if (item.contains("synopsis") && item["synopsis"].is_string()) {
-            content << "内容简介: " << item["synopsis"].get<std::string>() << "\n";
+        if (!notice.synopsis.empty()) {
+            content << "内容简介: " << notice.synopsis << "\n";
         }
 
         // 通知链接
-        if (item.contains("nnid")) {
-            content << "通知链接: https://dasai.lanqiao.cn/notices/"
-                    << item["nnid"].get<int>() << "\n";
+        if (!notice.link.empty()) {
+            content << "通知链接: " << notice.link << "\n";
         }
 
         content << "\n";
@@ -306,7 +1074,7 @@ std::string AlertMonitor::generateEmailContent(
 
 // 生成Server酱推送内容
 std::string AlertMonitor::generateServerChanContent(
-    const std::vector<nlohmann::json>& news_items,
+    const std::vector<NoticeEvent>& events,
     const std::vector<std::string>& trigger_keywords
 ) {
     std::ostringstream content;
@@ -323,27 +1091,34 @@ std::string AlertMonitor::generateServerChanContent(
 
     content << "---\n\n";
 
-    for (const auto& item : news_items) {
+    for (const auto& event : events) {
+        const Notice& notice = event.notice;
+
         // 标题
-        if (item.contains("title") && item["title"].is_string()) {
-            content << "### " << item["title"].get<std::string>() << "\n";
+        if (!notice.title.empty()) {
+            content << "### " << notice.title << "\n";
+        }
+
+        // 变化类型（新通知不标注）
+        if (event.kind == NoticeEvent::Kind::Edited) {
+            content << "- **状态**: 内容已更新\n";
+        } else if (event.kind == NoticeEvent::Kind::Removed) {
+            content << "- **状态**: 已删除\n";
         }
 
         // 创建时间
-        if (item.contains("creatTime") && item["creatTime"].is_string()) {
-            content << "- **发布时间**: " << utcToBeijingTime(item["creatTime"].get<std::string>()) << "\n";
+        if (!notice.creatTime.empty()) {
+            content << "- **发布时间**: " << utcToBeijingTime(notice.creatTime) << "\n";
         }
 
         // 栏目名称
-        if (item.contains("programaName") && item["programaName"].is_string()) {
-            content << "- **栏目**: " << item["programaName"].get<std::string>() << "\n";
+        if (!notice.programaName.empty()) {
+            content << "- **栏目**: " << notice.programaName << "\n";
         }
 
         // 通知链接
-        if (item.contains("nnid")) {
-            int nnid = item["nnid"].get<int>();
-            content << "- **通知链接**: [点击查看](https://dasai.lanqiao.cn/notices/"
-                    << nnid << ")\n";
+        if (!notice.link.empty()) {
+            content << "- **通知链接**: [点击查看](" << notice.link << ")\n";
         }
 
         content << "\n";
@@ -358,31 +1133,23 @@ std::string AlertMonitor::generateServerChanContent(
 // 发送Server酱推送
 bool AlertMonitor::sendServerChan(
     const ServerChanConfig& config,
-    const std::vector<nlohmann::json>& news_items,
-    const std::vector<std::string>& trigger_keywords
+    const std::string& title,
+    const std::string& desp,
+    const std::string& brief
 ) {
     // 构建API URL
     std::string url = "https://" + config.uid + ".push.ft07.com/send/" + config.sendkey + ".send";
 
-    // 生成推送内容
-    std::string desp = generateServerChanContent(news_items, trigger_keywords);
-
     // 构建请求JSON
     nlohmann::json request;
-    request["title"] = "蓝桥杯大赛通知提醒";
+    request["title"] = title;
     request["desp"] = desp;
-
-    // 获取第一条通知的标题作为简短描述
-    if (!news_items.empty() && news_items[0].contains("title")) {
-        request["short"] = news_items[0]["title"].get<std::string>();
-    } else {
-        request["short"] = "检测到新的重要通知";
-    }
-
+    request["short"] = brief;
     // 初始化CURL
+    CurlGlobal::ensureInit();
     CURL* curl = curl_easy_init();
     if (!curl) {
-        std::cerr << "初始化CURL失败" << std::endl;
+        Logger::error() << "初始化CURL失败";
         return false;
     }
 
@@ -402,7 +1169,9 @@ bool AlertMonitor::sendServerChan(
     curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
 
     // 执行请求
+    int64_t startUs = Tracer::nowUs();
     CURLcode res = curl_easy_perform(curl);
+    Tracer::recordCurlTimings(curl, startUs);
 
     // 清理资源
     curl_slist_free_all(headers);
@@ -410,7 +1179,7 @@ bool AlertMonitor::sendServerChan(
 
     // 检查结果
     if (res != CURLE_OK) {
-        std::cerr << "Server酱请求失败: " << curl_easy_strerror(res) << std::endl;
+        Logger::error() << "Server酱请求失败: " << curl_easy_strerror(res);
         return false;
     }
 
@@ -419,10 +1188,230 @@ bool AlertMonitor::sendServerChan(
         if (jsonResponse.contains("message") && jsonResponse["message"] == "SUCCESS") {
             return true;
         }
-        std::cerr << "Server酱返回错误: " << response << std::endl;
+        Logger::error() << "Server酱返回错误: " << response;
     } catch (...) {
-        std::cerr << "解析Server酱响应失败: " << response << std::endl;
+        Logger::error() << "解析Server酱响应失败: " << response;
     }
 
     return false;
 }
+
+long long AlertMonitor::eventKey(const NoticeEvent& event) {
+    switch (event.kind) {
+        case NoticeEvent::Kind::New:
+            return event.notice.nnid;
+        case NoticeEvent::Kind::Removed:
+            return -event.notice.nnid;
+        case NoticeEvent::Kind::Edited:
+            break;
+    }
+
+    // 编辑事件按 (nnid, 内容哈希) 去重：同一版本只提醒一次，再次编辑后会再提醒
+    // 结果置位第62位并保持为正数，与通知ID和删除事件的键区分开
+    uint64_t key = event.notice.hash ^ (static_cast<uint64_t>(event.notice.nnid) * 0x9E3779B97F4A7C15ULL);
+    key ^= key >> 31;
+    return static_cast<long long>((key & 0x3fffffffffffffffULL) | 0x4000000000000000ULL);
+}
+
+size_t AlertMonitor::enqueueNotifications(
+    const Config& config,
+    Outbox& outbox,
+    const std::vector<NoticeEvent>& events
+) {
+    const std::string subject = "蓝桥杯大赛通知提醒";
+    size_t queued = 0;
+
+    // 过滤出尚未投递给该收件人的通知
+    auto undelivered = [&](const std::string& channel, const std::string& recipient) {
+        std::vector<NoticeEvent> items;
+        for (const auto& event : events) {
+            if (!outbox.contains(eventKey(event), channel, recipient)) {
+                items.push_back(event);
+            }
+        }
+        return items;
+    };
+
+    auto makeEntry = [](const std::string& channel, const std::string& recipient,
+                        const std::vector<NoticeEvent>& items) {
+        Outbox::Entry entry;
+        entry.channel = channel;
+        entry.recipient = recipient;
+        for (const auto& event : items) {
+            entry.nnids.push_back(eventKey(event));
+        }
+        return entry;
+    };
+
+    {
+        Tracer::Span span("render");
+
+        for (const auto& recipient : config.recipients) {
+            auto items = undelivered("mail", recipient);
+            if (items.empty()) continue;
+
+            Outbox::Entry entry = makeEntry("mail", recipient, items);
+            entry.subject = subject;
+            entry.body = generateEmailContent(items, config.trigger_keywords);
+            outbox.enqueue(std::move(entry));
+            queued++;
+        }
+
+        if (config.server_chan.enabled) {
+            auto items = undelivered("serverchan", config.server_chan.uid);
+            if (!items.empty()) {
+                Outbox::Entry entry = makeEntry("serverchan", config.server_chan.uid, items);
+                entry.subject = subject;
+                entry.body = generateServerChanContent(items, config.trigger_keywords);
+
+                // 获取第一条通知的标题作为简短描述
+                if (!items[0].notice.title.empty()) {
+                    entry.brief = items[0].notice.title;
+                } else {
+                    entry.brief = "检测到新的重要通知";
+                }
+                outbox.enqueue(std::move(entry));
+                queued++;
+            }
+        }
+
+        span.arg("entries", queued);
+    }
+
+    // 整批条目只需一次fsync
+    Tracer::Span commitSpan("outbox.commit");
+    outbox.commit();
+    return queued;
+}
+
+size_t AlertMonitor::dispatchOutbox(const Config& config, State& state, const std::string& target) {
+    using Clock = std::chrono::steady_clock;
+
+    Outbox& outbox = state.outboxFor(target);
+    size_t failed = 0;
+
+    // 租约过期后目标可能已被其他实例接管：每次发送前续期租约，
+    // 发送结果写入发件箱前再次续期（租约的epoch变化说明已被接管），失败时不写入，由接管者补发
+    bool leaseLost = false;
+
+    std::vector<Outbox::Entry> mails;
+    for (auto& entry : outbox.pending()) {
+        if (entry.channel == "mail") {
+            mails.push_back(std::move(entry));
+            continue;
+        }
+
+        if (!state.renew(target)) {
+            leaseLost = true;
+            break;
+        }
+
+        Tracer::Span span("deliver");
+        span.arg("channel", entry.channel);
+        span.arg("recipient", entry.recipient);
+
+        bool ok = false;
+        if (entry.channel == "serverchan") {
+            Logger::info() << "发送Server酱推送...";
+            RateLimiter::acquire("serverchan");
+            ok = sendServerChan(config.server_chan, entry.subject, entry.body, entry.brief);
+            if (ok) {
+                Logger::info() << "Server酱推送成功";
+            } else {
+                Logger::error() << "Server酱推送失败";
+            }
+        } else {
+            Logger::error() << "未知的投递渠道: " << entry.channel;
+        }
+
+        span.arg("ok", ok);
+        if (!ok) {
+            failed++;
+        } else if (state.renew(target)) {
+            outbox.markDone(entry.id);
+        } else {
+            leaseLost = true;
+            break;
+        }
+    }
+
+    // 邮件分轮并发发送：每轮开始时续期，租约有效期过半后不再开始新的发送，进行中的传输在5/6处中止，
+    // 剩余的1/6留给写入前的续期；未发出的邮件留到下一轮（非分片模式不限时，一轮发完）
+    while (!leaseLost && !mails.empty()) {
+        if (!state.renew(target)) {
+            leaseLost = true;
+            break;
+        }
+        auto startBy = Clock::time_point::max();
+        auto finishBy = Clock::time_point::max();
+        if (state.coordinator) {
+            auto lease = std::chrono::duration_cast<std::chrono::milliseconds>(state.coordinator->lease());
+            auto now = Clock::now();
+            startBy = now + lease / 2;
+            finishBy = now + lease * 5 / 6;
+        }
+
+        std::vector<MailSender::Message> messages;
+        messages.reserve(mails.size());
+        for (const auto& entry : mails) {
+            messages.push_back({entry.recipient, entry.subject, entry.body});
+        }
+
+        Tracer::Span span("deliver");
+        span.arg("channel", "mail");
+        span.arg("count", messages.size());
+        Logger::info() << "发送邮件到 " << messages.size() << " 个收件人";
+
+        auto results = MailSender::sendBatch(config.smtp, messages, startBy, finishBy);
+        if (!state.renew(target)) {
+            leaseLost = true;
+            break;
+        }
+
+        std::vector<Outbox::Entry> deferred;
+        size_t roundFailed = 0;
+        size_t rejected = 0;
+        for (size_t i = 0; i < results.size(); ++i) {
+            const auto& result = results[i];
+            if (result.ok) {
+                Logger::debug() << "邮件发送成功: " << mails[i].recipient << " (" << result.relay << ")";
+                outbox.markDone(mails[i].id);
+            } else if (result.deferred) {
+                deferred.push_back(std::move(mails[i]));
+            } else if (result.permanent) {
+                // 重试不会成功，移出发件箱，否则每次检查都会重发并报告投递失败
+                Logger::error() << "邮件无法投递，已放弃: " << mails[i].recipient << ": " << result.error;
+                outbox.markDone(mails[i].id);
+                rejected++;
+            } else {
+                Logger::error() << "邮件发送失败: " << mails[i].recipient << ": " << result.error;
+                roundFailed++;
+            }
+        }
+        Logger::info() << "邮件发送完成: 成功 " << results.size() - roundFailed - rejected - deferred.size()
+                       << "，失败 " << roundFailed << "，被拒绝 " << rejected << "，延后 " << deferred.size();
+        span.arg("failed", roundFailed);
+        span.arg("rejected", rejected);
+        span.arg("deferred", deferred.size());
+        failed += roundFailed;
+
+        // 本轮的完成标记先落盘，再开始下一轮
+        outbox.commit();
+
+        if (deferred.size() == mails.size()) {
+            // 整轮没有任何进展，剩余邮件留在发件箱中下次重试
+            Logger::error() << "[" << target << "] 租约有效期内未能发出任何邮件，" << deferred.size() << " 封留待重试";
+            failed += deferred.size();
+            break;
+        }
+        mails = std::move(deferred);
+    }
+
+    if (leaseLost) {
+        Logger::warn() << "[" << target << "] 租约已失效，剩余通知交由接管的实例投递";
+    }
+
+    Tracer::Span commitSpan("outbox.commit");
+    outbox.commit();
+    return failed;
+}
@@ -0,0 +1,119 @@
+//
+// Created by athbe on 2026/10/18.
+//
+#include "CheckScheduler.h"
+#include <algorithm>
+
+CheckScheduler::CheckScheduler(const std::vector<std::string>& targets) {
+    for (const auto& target : targets) {
+        targets_[target];
+    }
+}
+
+CheckScheduler::Submit CheckScheduler::request(const std::string& target) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = targets_.find(target);
+        if (it == targets_.end()) {
+            return Submit::Unknown;
+        }
+        if (!it->second.owned) {
+            return Submit::NotOwner;
+        }
+        if (inFlight_ == target) {
+            return Submit::InFlight;
+        }
+        if (std::find(queue_.begin(), queue_.end(), target) != queue_.end()) {
+            return Submit::Pending;
+        }
+        queue_.push_back(target);
+    }
+    wake_.notify_one();
+    return Submit::Queued;
+}
+
+std::optional<std::string> CheckScheduler::waitUntil(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!wake_.wait_until(lock, deadline, [this] { return stopped_ || !queue_.empty(); }) || stopped_) {
+        return std::nullopt;
+    }
+    std::string target = std::move(queue_.front());
+    queue_.pop_front();
+    return target;
+}
+
+void CheckScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+    wake_.notify_all();
+}
+
+bool CheckScheduler::stopped() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stopped_;
+}
+
+void CheckScheduler::begin(const std::string& target) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    inFlight_ = target;
+
+    // 已排队的同一目标由本次检查覆盖
+    queue_.erase(std::remove(queue_.begin(), queue_.end(), target), queue_.end());
+
+    auto& status = targets_[target];
+    status.checks++;
+    status.lastCheck = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void CheckScheduler::finish(const std::string& target, const std::string& result, std::chrono::milliseconds duration) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (inFlight_ == target) {
+        inFlight_.clear();
+    }
+    auto& status = targets_[target];
+    status.lastResult = result;
+    status.lastDurationMs = duration.count();
+}
+
+void CheckScheduler::setOwned(const std::string& target, bool owned) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    targets_[target].owned = owned;
+}
+
+nlohmann::json CheckScheduler::status() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    nlohmann::json targets = nlohmann::json::array();
+    for (const auto& [name, status] : targets_) {
+        targets.push_back({
+            {"name", name},
+            {"owned", status.owned},
+            {"checks", status.checks},
+            {"last_check", status.lastCheck},
+            {"last_duration_ms", status.lastDurationMs},
+            {"last_result", status.lastResult}
+        });
+    }
+
+    return {
+        {"uptime_s", std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::steady_clock::now() - started_).count()},
+        {"in_flight", inFlight_},
+        {"queued", queue_},
+        {"targets", targets}
+    };
+}
+
+const char* CheckScheduler::submitName(Submit submit) {
+    switch (submit) {
+        case Submit::Queued: return "queued";
+        case Submit::Pending: return "pending";
+        case Submit::InFlight: return "in_flight";
+        case Submit::NotOwner: return "not_owner";
+        case Submit::Unknown: return "unknown_target";
+    }
+    return "unknown";
+}
@@ -0,0 +1,290 @@
+//
+// Created by athbe on 2026/10/18.
+//
+#include "ControlServer.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kMaxRequest = 8192;  // 单个请求头 / 命令行的上限
+
+std::string errnoText(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+// 写出完整缓冲区，客户端提前关闭时放弃
+void sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+
+// 解码URL路径中的 %XX
+std::string percentDecode(const std::string& text) {
+    std::string out;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '%' && i + 2 < text.size() &&
+            std::isxdigit(static_cast<unsigned char>(text[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+            out += static_cast<char>(std::stoi(text.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else {
+            out += text[i];
+        }
+    }
+    return out;
+}
+
+const char* reasonPhrase(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        default: return "Error";
+    }
+}
+
+} // namespace
+
+ControlServer::ControlServer(Options options, Handler handler)
+    : options_(std::move(options)), handler_(std::move(handler)) {
+    if (::pipe2(stopPipe_, O_CLOEXEC) != 0) {
+        throw std::runtime_error(errnoText("无法创建控制管道"));
+    }
+
+    try {
+        if (!options_.socket_path.empty()) {
+            sockaddr_un addr = {};
+            addr.sun_family = AF_UNIX;
+            if (options_.socket_path.size() >= sizeof(addr.sun_path)) {
+                throw std::runtime_error("控制套接字路径过长: " + options_.socket_path);
+            }
+            std::strcpy(addr.sun_path, options_.socket_path.c_str());
+
+            unixFd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (unixFd_ < 0) {
+                throw std::runtime_error(errnoText("无法创建控制套接字"));
+            }
+
+            // 残留的套接字文件：能连上说明另一个实例正在使用，否则删除
+            if (::connect(unixFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+                throw std::runtime_error("控制套接字已被其他进程使用: " + options_.socket_path);
+            }
+            ::close(unixFd_);
+            ::unlink(options_.socket_path.c_str());
+
+            unixFd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (unixFd_ < 0 ||
+                ::bind(unixFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+                ::listen(unixFd_, 16) != 0) {
+                throw std::runtime_error(errnoText("无法监听控制套接字 " + options_.socket_path));
+            }
+        }
+
+        if (options_.http_port > 0) {
+            sockaddr_in addr = {};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(static_cast<uint16_t>(options_.http_port));
+            if (::inet_pton(AF_INET, options_.http_bind.c_str(), &addr.sin_addr) != 1) {
+                throw std::runtime_error("无效的监听地址: " + options_.http_bind);
+            }
+
+            httpFd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            int reuse = 1;
+            if (httpFd_ < 0 ||
+                ::setsockopt(httpFd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+                ::bind(httpFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+                ::listen(httpFd_, 16) != 0) {
+                throw std::runtime_error(errnoText("无法监听HTTP端口 " + std::to_string(options_.http_port)));
+            }
+        }
+    } catch (...) {
+        if (unixFd_ >= 0) ::close(unixFd_);
+        if (httpFd_ >= 0) ::close(httpFd_);
+        ::close(stopPipe_[0]);
+        ::close(stopPipe_[1]);
+        throw;
+    }
+
+    thread_ = std::thread(&ControlServer::serve, this);
+}
+
+ControlServer::~ControlServer() {
+    char byte = 0;
+    (void)::write(stopPipe_[1], &byte, 1);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    if (unixFd_ >= 0) {
+        ::close(unixFd_);
+        ::unlink(options_.socket_path.c_str());
+    }
+    if (httpFd_ >= 0) ::close(httpFd_);
+    ::close(stopPipe_[0]);
+    ::close(stopPipe_[1]);
+}
+
+void ControlServer::serve() {
+    pollfd fds[3] = {
+        {stopPipe_[0], POLLIN, 0},
+        {unixFd_, POLLIN, 0},
+        {httpFd_, POLLIN, 0}
+    };
+
+    while (true) {
+        int n = ::poll(fds, 3, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            Logger::error() << "控制接口poll失败: " << std::strerror(errno);
+            return;
+        }
+        if (fds[0].revents) {
+            return;
+        }
+
+        for (int i = 1; i < 3; ++i) {
+            if (fds[i].fd < 0 || !(fds[i].revents & POLLIN)) continue;
+
+            int client = ::accept4(fds[i].fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0) continue;
+
+            // 单线程逐个处理，慢客户端最多占用1秒
+            timeval timeout = {1, 0};
+            ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            try {
+                if (i == 1) {
+                    handleLines(client);
+                } else {
+                    handleHttp(client);
+                }
+            } catch (const std::exception& e) {
+                Logger::warn() << "控制请求处理失败: " << e.what();
+            }
+            ::close(client);
+        }
+    }
+}
+
+void ControlServer::handleLines(int fd) {
+    std::string buffer;
+    char chunk[512];
+
+    while (true) {
+        size_t newline;
+        while ((newline = buffer.find('\n')) != std::string::npos) {
+            std::string line = buffer.substr(0, newline);
+            buffer.erase(0, newline + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+
+            std::istringstream ss(line);
+            std::string command;
+            std::string target;
+            ss >> command;
+            std::getline(ss >> std::ws, target);
+
+            sendAll(fd, handler_(command, target).dump() + "\n");
+        }
+        if (buffer.size() > kMaxRequest) {
+            return;
+        }
+
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            // 最后一条命令可以不带换行
+            if (n == 0 && !buffer.empty()) {
+                buffer += '\n';
+                continue;
+            }
+            return;
+        }
+        buffer.append(chunk, static_cast<size_t>(n));
+    }
+}
+
+void ControlServer::handleHttp(int fd) {
+    std::string request;
+    char chunk[1024];
+    size_t headerEnd;
+    while ((headerEnd = request.find("\r\n\r\n")) == std::string::npos) {
+        if (request.size() > kMaxRequest) return;
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        request.append(chunk, static_cast<size_t>(n));
+    }
+
+    std::istringstream ss(request.substr(0, headerEnd));
+    std::string method;
+    std::string target;
+    ss >> method >> target;
+    target = target.substr(0, target.find('?'));
+
+    // 读完请求体再响应，避免关闭连接时丢弃响应
+    size_t contentLength = 0;
+    std::string header;
+    std::getline(ss, header);
+    while (std::getline(ss, header)) {
+        if (header.size() > 15 && strncasecmp(header.c_str(), "content-length:", 15) == 0) {
+            contentLength = std::min<size_t>(std::strtoul(header.c_str() + 15, nullptr, 10), 65536);
+        }
+    }
+    size_t received = request.size() - headerEnd - 4;
+    while (received < contentLength) {
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        received += static_cast<size_t>(n);
+    }
+
+    int code = 200;
+    nlohmann::json body;
+    if (target == "/status") {
+        body = method == "GET" ? handler_("status", "") : nlohmann::json{{"error", "use GET"}};
+        code = method == "GET" ? 200 : 405;
+    } else if (target == "/check" || target.rfind("/check/", 0) == 0) {
+        if (method == "POST") {
+            body = handler_("check", target.size() > 7 ? percentDecode(target.substr(7)) : "");
+            code = body.contains("error") ? 404 : 200;
+        } else {
+            body = {{"error", "use POST"}};
+            code = 405;
+        }
+    } else {
+        body = {{"error", "not found"}};
+        code = 404;
+    }
+
+    std::string payload = body.dump() + "\n";
+    std::ostringstream response;
+    response << "HTTP/1.1 " << code << " " << reasonPhrase(code) << "\r\n"
+             << "Content-Type: application/json\r\n"
+             << "Content-Length: " << payload.size() << "\r\n"
+             << "Connection: close\r\n\r\n"
+             << payload;
+    sendAll(fd, response.str());
+}
@@ -0,0 +1,69 @@
+//
+// Created by athbe on 2026/10/18.
+//
+#include "CycleArena.h"
+#include <algorithm>
+
+namespace {
+
+constexpr size_t kMaxRetained = 16 * 1024 * 1024;  // 复位后最多保留的内存
+
+thread_local std::pmr::memory_resource* tCurrent = nullptr;
+
+} // namespace
+
+CycleArena::CycleArena(size_t block_size) : blockSize_(block_size) {}
+
+std::pmr::memory_resource* CycleArena::current() {
+    return tCurrent ? tCurrent : std::pmr::new_delete_resource();
+}
+
+void* CycleArena::do_allocate(size_t bytes, size_t alignment) {
+    auto place = [&](Block& block) -> void* {
+        auto base = reinterpret_cast<uintptr_t>(block.data.get());
+        size_t aligned = ((base + offset_ + alignment - 1) & ~(uintptr_t{alignment} - 1)) - base;
+        if (aligned + bytes > block.size) {
+            return nullptr;
+        }
+        offset_ = aligned + bytes;
+        return block.data.get() + aligned;
+    };
+
+    // 先在当前块及之后保留下来的块中查找空间
+    for (; current_ < blocks_.size(); ++current_, offset_ = 0) {
+        if (void* p = place(blocks_[current_])) {
+            return p;
+        }
+    }
+
+    // 新增一块，超大的分配单独占用一块
+    Block block;
+    block.size = std::max(blockSize_, bytes + alignment);
+    block.data = std::make_unique<std::byte[]>(block.size);
+    capacity_ += block.size;
+    blocks_.push_back(std::move(block));
+
+    current_ = blocks_.size() - 1;
+    offset_ = 0;
+    return place(blocks_[current_]);
+}
+
+void CycleArena::reset() {
+    current_ = 0;
+    offset_ = 0;
+
+    // 某次检查异常膨胀时归还多出的内存，避免峰值被永久保留
+    while (capacity_ > kMaxRetained && !blocks_.empty()) {
+        capacity_ -= blocks_.back().size;
+        blocks_.pop_back();
+    }
+}
+
+CycleArena::Scope::Scope(CycleArena& arena) : arena_(arena), previous_(tCurrent) {
+    tCurrent = &arena_;
+}
+
+CycleArena::Scope::~Scope() {
+    tCurrent = previous_;
+    arena_.reset();
+}
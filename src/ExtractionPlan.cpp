@@ -0,0 +1,210 @@
+//
+// Created by athbe on 2026/10/18.
+//
+#include "ExtractionPlan.h"
+#include "NoticeSnapshot.h"
+#include <algorithm>
+#include <cctype>
+#include <deque>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+// 64位FNV-1a，用于非数字ID
+long long hashId(const std::string& text) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return static_cast<long long>(hash & 0x7fffffffffffffffULL);
+}
+
+bool allDigits(const std::string& text) {
+    return !text.empty() && text.size() <= 18 &&
+           std::all_of(text.begin(), text.end(), [](unsigned char c) { return std::isdigit(c); });
+}
+
+// 链接中的字段值按URL编码（保留非保留字符）
+void appendEscaped(std::string& out, const std::string& text) {
+    static const char* hex = "0123456789ABCDEF";
+    for (unsigned char c : text) {
+        if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            out += static_cast<char>(c);
+        } else {
+            out += '%';
+            out += hex[c >> 4];
+            out += hex[c & 0x0f];
+        }
+    }
+}
+
+} // namespace
+
+ExtractionPlan::ExtractionPlan() : ExtractionPlan(Mapping{}) {}
+
+ExtractionPlan::ExtractionPlan(const Mapping& mapping)
+    : list_(compilePointer(mapping.list)),
+      id_(compilePointer(mapping.id)),
+      title_(compilePointer(mapping.title)),
+      time_(compilePointer(mapping.time)),
+      category_(compilePointer(mapping.category)),
+      summary_(compilePointer(mapping.summary)),
+      link_(compileTemplate(mapping.link)) {}
+
+ExtractionPlan::Path ExtractionPlan::compilePointer(const std::string& pointer) {
+    Path path;
+    if (pointer.empty()) {
+        return path;
+    }
+
+    // 借助json_pointer完成语法检查和 ~0 / ~1 转义，再拆分为逐级步骤
+    nlohmann::json::json_pointer parsed;
+    try {
+        parsed = nlohmann::json::json_pointer(pointer);
+    } catch (const nlohmann::json::exception& e) {
+        throw std::runtime_error("无效的JSON Pointer \"" + pointer + "\": " + e.what());
+    }
+
+    std::deque<std::string> tokens;
+    while (!parsed.empty()) {
+        tokens.push_front(parsed.back());
+        parsed.pop_back();
+    }
+    for (auto& token : tokens) {
+        Step step;
+        step.numeric = allDigits(token);
+        if (step.numeric) {
+            step.index = std::stoull(token);
+        }
+        step.key = std::move(token);
+        path.push_back(std::move(step));
+    }
+    return path;
+}
+
+std::vector<ExtractionPlan::Segment> ExtractionPlan::compileTemplate(const std::string& link) {
+    std::vector<Segment> segments;
+    size_t pos = 0;
+    while (pos < link.size()) {
+        size_t open = link.find('{', pos);
+        if (open == std::string::npos) {
+            segments.push_back({link.substr(pos), Field::None});
+            break;
+        }
+        if (open > pos) {
+            segments.push_back({link.substr(pos, open - pos), Field::None});
+        }
+
+        size_t close = link.find('}', open);
+        if (close == std::string::npos) {
+            throw std::runtime_error("链接模板缺少 '}': " + link);
+        }
+        std::string name = link.substr(open + 1, close - open - 1);
+        Segment segment;
+        if (name == "id") {
+            segment.field = Field::Id;
+        } else if (name == "title") {
+            segment.field = Field::Title;
+        } else if (name == "time") {
+            segment.field = Field::Time;
+        } else if (name == "category") {
+            segment.field = Field::Category;
+        } else {
+            throw std::runtime_error("链接模板中未知的占位符: {" + name + "}");
+        }
+        segments.push_back(std::move(segment));
+        pos = close + 1;
+    }
+    return segments;
+}
+
+const ArenaJson* ExtractionPlan::resolve(const ArenaJson& root, const Path& path) {
+    const ArenaJson* node = &root;
+    for (const auto& step : path) {
+        if (node->is_object()) {
+            auto it = node->find(std::string_view(step.key));
+            if (it == node->end()) return nullptr;
+            node = &*it;
+        } else if (node->is_array() && step.numeric && step.index < node->size()) {
+            node = &(*node)[step.index];
+        } else {
+            return nullptr;
+        }
+    }
+    return node;
+}
+
+std::string ExtractionPlan::stringAt(const ArenaJson& item, const Path& path) {
+    if (path.empty()) {
+        return "";
+    }
+    const ArenaJson* node = resolve(item, path);
+    if (!node) {
+        return "";
+    }
+    // 字段值从内存池复制到通知中（通知会保存在快照里，生命周期长于本次检查）
+    if (node->is_string()) {
+        const auto& text = node->get_ref<const ArenaString&>();
+        return std::string(text.data(), text.size());
+    }
+    if (node->is_number()) {
+        auto text = node->dump();
+        return std::string(text.data(), text.size());
+    }
+    return "";
+}
+
+std::vector<Notice> ExtractionPlan::extract(const ArenaJson& document) const {
+    std::vector<Notice> notices;
+
+    const ArenaJson* list = resolve(document, list_);
+    if (!list || !list->is_array()) {
+        return notices;
+    }
+
+    notices.reserve(list->size());
+    for (const auto& item : *list) {
+        if (!item.is_object()) continue;
+
+        Notice notice;
+        notice.title = stringAt(item, title_);
+        notice.creatTime = stringAt(item, time_);
+        notice.programaName = stringAt(item, category_);
+        notice.synopsis = stringAt(item, summary_);
+
+        // 通知ID：整数直接使用，其他形式取哈希
+        std::string rawId;
+        const ArenaJson* id = id_.empty() ? nullptr : resolve(item, id_);
+        if (id && id->is_number_integer()) {
+            notice.nnid = id->get<long long>();
+            rawId = std::to_string(notice.nnid);
+        } else if (id && id->is_string() && !id->get_ref<const ArenaString&>().empty()) {
+            const auto& text = id->get_ref<const ArenaString&>();
+            rawId.assign(text.data(), text.size());
+            notice.nnid = allDigits(rawId) ? std::stoll(rawId) : hashId(rawId);
+        } else {
+            // 没有ID的通知以标题哈希作为ID
+            notice.nnid = hashId(notice.title);
+        }
+
+        bool missingId = false;
+        for (const auto& segment : link_) {
+            switch (segment.field) {
+                case Field::None: notice.link += segment.text; break;
+                case Field::Id: appendEscaped(notice.link, rawId); missingId = rawId.empty(); break;
+                case Field::Title: appendEscaped(notice.link, notice.title); break;
+                case Field::Time: appendEscaped(notice.link, notice.creatTime); break;
+                case Field::Category: appendEscaped(notice.link, notice.programaName); break;
+            }
+        }
+        if (missingId) {
+            notice.link.clear();
+        }
+
+        notice.hash = NoticeSnapshot::contentHash(notice);
+        notices.push_back(std::move(notice));
+    }
+    return notices;
+}
@@ -0,0 +1,131 @@
+//
+// Created by athbe on 2026/10/18.
+//
+#include "HostHealth.h"
+#include <curl/curl.h>
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+HostHealth& HostHealth::forHost(const std::string& host) {
+    static std::mutex registryMutex;
+    static std::unordered_map<std::string, std::unique_ptr<HostHealth>> registry;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    auto& slot = registry[host];
+    if (!slot) {
+        slot.reset(new HostHealth());
+    }
+    return *slot;
+}
+
+std::string HostHealth::hostOf(const std::string& url) {
+    std::string host = url;
+    CURLU* handle = curl_url();
+    if (!handle) {
+        return host;
+    }
+
+    char* part = nullptr;
+    if (curl_url_set(handle, CURLUPART_URL, url.c_str(), 0) == CURLUE_OK &&
+        curl_url_get(handle, CURLUPART_HOST, &part, 0) == CURLUE_OK) {
+        host = part;
+        curl_free(part);
+    }
+    curl_url_cleanup(handle);
+    return host;
+}
+
+bool HostHealth::allowRequest() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    switch (state_) {
+        case State::Closed:
+            return true;
+        case State::Open:
+            if (std::chrono::steady_clock::now() - openedAt_ < cooldown_) {
+                return false;
+            }
+            // 冷却结束，转入半开状态并放行探测请求
+            state_ = State::HalfOpen;
+            probeInFlight_ = true;
+            return true;
+        case State::HalfOpen:
+            if (probeInFlight_) {
+                return false;
+            }
+            probeInFlight_ = true;
+            return true;
+    }
+    return false;
+}
+
+void HostHealth::recordSuccess(Millis latency) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    samples_[sampleHead_] = latency.count();
+    sampleHead_ = (sampleHead_ + 1) % kWindow;
+    sampleCount_ = std::min(sampleCount_ + 1, kWindow);
+
+    consecutiveFailures_ = 0;
+    probeInFlight_ = false;
+    state_ = State::Closed;
+    cooldown_ = kBaseCooldown;
+}
+
+void HostHealth::recordFailure() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (state_ == State::HalfOpen) {
+        // 探测失败，重新熔断并延长冷却时间
+        probeInFlight_ = false;
+        state_ = State::Open;
+        openedAt_ = std::chrono::steady_clock::now();
+        cooldown_ = std::min(cooldown_ * 2, kMaxCooldown);
+        return;
+    }
+
+    if (++consecutiveFailures_ >= kFailureThreshold && state_ == State::Closed) {
+        state_ = State::Open;
+        openedAt_ = std::chrono::steady_clock::now();
+    }
+}
+
+HostHealth::Millis HostHealth::percentile(double q) const {
+    std::vector<long long> sorted(samples_.begin(), samples_.begin() + sampleCount_);
+    size_t index = static_cast<size_t>(q * static_cast<double>(sorted.size() - 1) + 0.5);
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return Millis(sorted[index]);
+}
+
+std::optional<HostHealth::Millis> HostHealth::hedgeDelay() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sampleCount_ < kMinSamples || state_ != State::Closed) {
+        return std::nullopt;
+    }
+    return percentile(0.95);
+}
+
+HostHealth::Millis HostHealth::timeout() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sampleCount_ < kMinSamples) {
+        return kDefaultTimeout;
+    }
+    // 给尾部延迟留出余量：p99的4倍，限制在 [2s, 15s]
+    return std::clamp(percentile(0.99) * 4, kMinTimeout, kMaxTimeout);
+}
+
+HostHealth::State HostHealth::state() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return state_;
+}
+
+HostHealth::Millis HostHealth::retryAfter() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (state_ != State::Open) {
+        return Millis(0);
+    }
+    auto elapsed = std::chrono::duration_cast<Millis>(std::chrono::steady_clock::now() - openedAt_);
+    return std::max(Millis(0), cooldown_ - elapsed);
+}
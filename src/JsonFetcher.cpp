@@ -2,14 +2,25 @@
 // Created by athbe on 2025/6/17.
 //
 #include "JsonFetcher.h"
-#include <iostream>
+#include "HostHealth.h"
+#include "Tracer.h"
+#include "RateLimiter.h"
+#include "CurlGlobal.h"
+#include "ResponseCapture.h"
 #include <sstream>
 #include <stdexcept>
 #include <cstring>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <memory>
 
 // 初始化线程本地错误信息
 thread_local std::string JsonFetcher::lastError = "";
 
+// 录制文件，未启用录制时为空
+static std::unique_ptr<ResponseCapture::Writer> recorder;
+
 size_t JsonFetcher::writeCallback(void* contents, size_t size, size_t nmemb, void* userp) {
     size_t realsize = size * nmemb;
     std::string* response = static_cast<std::string*>(userp);
@@ -21,68 +32,211 @@ std::string JsonFetcher::getLastError() {
     return lastError;
 }
 
-std::optional<nlohmann::json> JsonFetcher::fetchFromUrl(const std::string& url) {
-    lastError.clear();
+void JsonFetcher::startRecording(const std::string& path) {
+    recorder = std::make_unique<ResponseCapture::Writer>(path);
+}
 
+CURL* JsonFetcher::createHandle(const std::string& url, std::string& response, long timeout_ms,
+                                std::string* headers) {
     CURL* curl = curl_easy_init();
     if (!curl) {
-        lastError = "Failed to initialize CURL";
-        return std::nullopt;
+        return nullptr;
     }
 
-    std::string response;
-    long http_code = 0;
-    CURLcode res = CURLE_OK;
-
     // 设置CURL选项
     curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeCallback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
     curl_easy_setopt(curl, CURLOPT_USERAGENT, "JsonFetcher/1.0");
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 15L);
-    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout_ms);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, std::min(timeout_ms, 10000L));
     curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
     curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    if (headers) {
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, writeCallback);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, headers);
+    }
+
+    return curl;
+}
+
+bool JsonFetcher::performHedged(const std::string& url, std::string& response, std::string* headers, long* status) {
+    using Clock = std::chrono::steady_clock;
+
+    const std::string host = HostHealth::hostOf(url);
+    HostHealth& health = HostHealth::forHost(host);
+    if (!health.allowRequest()) {
+        std::ostringstream oss;
+        oss << "Circuit open, retry in " << health.retryAfter().count() / 1000 << "s";
+        lastError = oss.str();
+        return false;
+    }
 
-    // 执行请求
-    res = curl_easy_perform(curl);
+    const long timeoutMs = static_cast<long>(health.timeout().count());
+    auto hedgeDelay = health.hedgeDelay();
 
-    // 获取HTTP状态码
-    if (res == CURLE_OK) {
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    // 一个主请求和至多一个对冲请求
+    struct Attempt {
+        CURL* handle = nullptr;
+        std::string body;
+        std::string headers;
+        Clock::time_point start;
+        int64_t startUs = 0;
+        bool done = false;
+    };
+    std::array<Attempt, 2> attempts;
+    int launched = 0;
+
+    CURLM* multi = curl_multi_init();
+    if (!multi) {
+        lastError = "Failed to initialize CURL multi handle";
+        health.recordFailure();
+        return false;
     }
 
-    // 检查错误
-    if (res != CURLE_OK) {
-        lastError = "CURL error: ";
-        lastError += curl_easy_strerror(res);
-        curl_easy_cleanup(curl);
-        return std::nullopt;
+    auto launch = [&]() {
+        Attempt& attempt = attempts[launched];
+        attempt.handle = createHandle(url, attempt.body, timeoutMs, headers ? &attempt.headers : nullptr);
+        if (!attempt.handle) {
+            return false;
+        }
+        attempt.start = Clock::now();
+        attempt.startUs = Tracer::nowUs();
+        curl_multi_add_handle(multi, attempt.handle);
+        launched++;
+        return true;
+    };
+
+    if (!launch()) {
+        lastError = "Failed to initialize CURL";
+        curl_multi_cleanup(multi);
+        health.recordFailure();
+        return false;
     }
 
-    // 清理CURL资源
-    curl_easy_cleanup(curl);
+    Attempt* winner = nullptr;
+    Attempt* answered = nullptr;  // 最后一个返回非200状态码的请求
+    long answeredCode = 0;
+    int finished = 0;
 
-    // 检查HTTP状态码
-    if (http_code != 200) {
-        std::ostringstream oss;
-        oss << "HTTP error: " << http_code;
-        lastError = oss.str();
-        return std::nullopt;
+    while (!winner && finished < launched) {
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        // 处理已完成的请求
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi, &queued)) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            finished++;
+
+            Attempt* attempt = (msg->easy_handle == attempts[0].handle) ? &attempts[0] : &attempts[1];
+            attempt->done = true;
+            if (msg->data.result != CURLE_OK) {
+                lastError = "CURL error: ";
+                lastError += curl_easy_strerror(msg->data.result);
+                continue;
+            }
+
+            // 获取HTTP状态码
+            long http_code = 0;
+            curl_easy_getinfo(attempt->handle, CURLINFO_RESPONSE_CODE, &http_code);
+            if (http_code == 200) {
+                winner = attempt;
+                break;
+            }
+
+            std::ostringstream oss;
+            oss << "HTTP error: " << http_code;
+            lastError = oss.str();
+            answered = attempt;
+            answeredCode = http_code;
+        }
+
+        if (winner || finished >= launched) {
+            break;
+        }
+
+        // 主请求超过p95仍未完成时发出对冲请求
+        int waitMs = 1000;
+        if (launched == 1 && hedgeDelay) {
+            auto elapsed = std::chrono::duration_cast<HostHealth::Millis>(Clock::now() - attempts[0].start);
+            if (elapsed >= *hedgeDelay) {
+                // 对冲请求同样受限流约束；没有令牌或创建请求失败时放弃对冲，不再重试
+                if (RateLimiter::tryAcquire(host)) {
+                    launch();
+                }
+                hedgeDelay.reset();
+                continue;
+            }
+            waitMs = static_cast<int>(std::min<long long>(waitMs, (*hedgeDelay - elapsed).count() + 1));
+        }
+
+        curl_multi_poll(multi, nullptr, 0, waitMs, nullptr);
+    }
+
+    // 没有200响应时交出服务器返回的错误响应（供录制），传输失败时没有响应
+    Attempt* result = winner ? winner : answered;
+    if (status) {
+        *status = winner ? 200 : answeredCode;
+    }
+    if (result) {
+        response = std::move(result->body);
+        if (headers) {
+            *headers = std::move(result->headers);
+        }
+    }
+
+    // 清理CURL资源（未完成的请求直接放弃）
+    for (int i = 0; i < launched; ++i) {
+        if (attempts[i].done) {
+            Tracer::recordCurlTimings(attempts[i].handle, attempts[i].startUs, i);
+        }
+        curl_multi_remove_handle(multi, attempts[i].handle);
+        curl_easy_cleanup(attempts[i].handle);
+    }
+    curl_multi_cleanup(multi);
+
+    if (!winner) {
+        health.recordFailure();
+        return false;
+    }
+
+    // 从主请求发出时计时：对冲请求获胜时记录的是调用方实际等待的时间，而不是对冲请求自身更短的耗时，
+    // 否则p95/p99会被拉低，对冲触发得越来越早
+    health.recordSuccess(std::chrono::duration_cast<HostHealth::Millis>(Clock::now() - attempts[0].start));
+    return true;
+}
+
+bool JsonFetcher::fetchBody(const std::string& url, std::string& body) {
+    lastError.clear();
+    CurlGlobal::ensureInit();
+
+    Tracer::Span span("fetch");
+    body.clear();
+
+    // 录制时额外收集响应头和耗时；非200响应同样录制，传输失败（没有响应）时不录制
+    ResponseCapture::Record record;
+    long status = 0;
+    int64_t startUs = Tracer::nowUs();
+    bool ok = performHedged(url, body, recorder ? &record.headers : nullptr, &status);
+
+    if (recorder && status != 0) {
+        record.url = url;
+        record.fetchedAt = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        record.durationUs = Tracer::nowUs() - startUs;
+        record.status = static_cast<int>(status);
+        record.body = body;
+        recorder->append(record);
     }
 
-    // 尝试解析JSON
-    try {
-        nlohmann::json jsonData = nlohmann::json::parse(response);
-        return jsonData;
-    } catch (const nlohmann::json::parse_error& e) {
-        lastError = "JSON parse error: ";
-        lastError += e.what();
-        return std::nullopt;
-    } catch (const std::exception& e) {
-        lastError = "Error: ";
-        lastError += e.what();
-        return std::nullopt;
+    if (!ok) {
+        body.clear();
+        span.arg("error", lastError);
+        return false;
     }
+    span.arg("bytes", body.size());
+    return true;
 }
@@ -0,0 +1,374 @@
+//
+// Created by athbe on 2026/10/18.
+//
+#include "Logger.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+constexpr size_t kCapacity = 4096;  // 环形缓冲区槽位数（2的幂）
+
+// 缓冲区槽位，sequence 用于生产者/消费者之间的交接
+struct Slot {
+    std::atomic<uint64_t> sequence{0};
+    Logger::Level level = Logger::Level::Info;
+    int64_t timestampNs = 0;
+    uint32_t length = 0;
+    char text[Logger::kMaxMessage];
+};
+
+// 多生产者单消费者的有界队列
+struct Ring {
+    Slot slots[kCapacity];
+    alignas(64) std::atomic<uint64_t> enqueuePos{0};
+    alignas(64) uint64_t dequeuePos = 0;
+
+    Ring() {
+        for (size_t i = 0; i < kCapacity; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+};
+
+// 重复消息的抑制状态
+struct Suppression {
+    Logger::Level level = Logger::Level::Warn;
+    int64_t lastEmitNs = 0;
+    uint64_t suppressed = 0;
+};
+
+std::atomic<int> gLevel{static_cast<int>(Logger::Level::Info)};
+std::atomic<int> gFormat{static_cast<int>(Logger::Format::Text)};
+std::atomic<int> gRateLimitSeconds{60};
+
+std::unique_ptr<Ring> gRing;
+std::thread gWriter;
+std::once_flag gStartOnce;
+std::atomic<bool> gRunning{false};
+std::atomic<bool> gStopRequested{false};
+std::atomic<int> gProducers{0};  // 已通过运行状态检查、尚未发布完消息的生产者
+std::mutex gDirectMutex;  // 后台线程停止后直接输出时使用
+FILE* gLastStream = nullptr;  // 上一条消息写入的流（后台线程或持有 gDirectMutex 时访问）
+
+std::unordered_map<std::string, Suppression> gSuppressions;  // 仅后台线程访问
+
+const char* levelName(Logger::Level level) {
+    switch (level) {
+        case Logger::Level::Debug: return "DEBUG";
+        case Logger::Level::Info: return "INFO";
+        case Logger::Level::Warn: return "WARN";
+        case Logger::Level::Error: return "ERROR";
+    }
+    return "INFO";
+}
+
+const char* levelKey(Logger::Level level) {
+    switch (level) {
+        case Logger::Level::Debug: return "debug";
+        case Logger::Level::Info: return "info";
+        case Logger::Level::Warn: return "warn";
+        case Logger::Level::Error: return "error";
+    }
+    return "info";
+}
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void appendJsonEscaped(std::string& out, std::string_view text) {
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+        }
+    }
+}
+
+// 写入一行；换到另一个流之前先刷新前一个流，重定向到同一文件时保持消息顺序
+void writeLine(const std::string& line, FILE* stream) {
+    if (gLastStream != nullptr && gLastStream != stream) {
+        std::fflush(gLastStream);
+    }
+    gLastStream = stream;
+    std::fwrite(line.data(), 1, line.size(), stream);
+}
+
+// 格式化并写出一条消息
+void emit(Logger::Level level, int64_t timestampNs, std::string_view text, uint64_t suppressed) {
+    time_t seconds = static_cast<time_t>(timestampNs / 1000000000);
+    int millis = static_cast<int>((timestampNs / 1000000) % 1000);
+
+    std::string line;
+    line.reserve(text.size() + 64);
+    char stamp[40];
+    std::tm tm{};
+
+    if (static_cast<Logger::Format>(gFormat.load(std::memory_order_relaxed)) == Logger::Format::Json) {
+        gmtime_r(&seconds, &tm);
+        std::strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &tm);
+        line += "{\"ts\":\"";
+        line += stamp;
+        std::snprintf(stamp, sizeof(stamp), ".%03dZ", millis);
+        line += stamp;
+        line += "\",\"level\":\"";
+        line += levelKey(level);
+        line += "\",\"msg\":\"";
+        appendJsonEscaped(line, text);
+        line += '"';
+        if (suppressed > 0) {
+            line += ",\"suppressed\":";
+            line += std::to_string(suppressed);
+        }
+        line += "}\n";
+        writeLine(line, stdout);
+        return;
+    }
+
+    localtime_r(&seconds, &tm);
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+    line += stamp;
+    std::snprintf(stamp, sizeof(stamp), ".%03d [%s] ", millis, levelName(level));
+    line += stamp;
+    line += text;
+    if (suppressed > 0) {
+        line += " (此前重复 " + std::to_string(suppressed) + " 次已省略)";
+    }
+    line += '\n';
+    writeLine(line, level >= Logger::Level::Warn ? stderr : stdout);
+}
+
+// 对警告/错误做重复抑制，返回是否需要输出
+bool admit(Logger::Level level, int64_t timestampNs, std::string_view text, uint64_t& suppressed) {
+    suppressed = 0;
+    int window = gRateLimitSeconds.load(std::memory_order_relaxed);
+    if (level < Logger::Level::Warn || window <= 0) {
+        return true;
+    }
+
+    const int64_t windowNs = static_cast<int64_t>(window) * 1000000000;
+
+    // 表过大时清理窗口外的条目，并补报被省略的次数
+    if (gSuppressions.size() > 1024) {
+        for (auto it = gSuppressions.begin(); it != gSuppressions.end();) {
+            if (timestampNs - it->second.lastEmitNs >= windowNs) {
+                if (it->second.suppressed > 0) {
+                    emit(it->second.level, timestampNs, it->first, it->second.suppressed);
+                }
+                it = gSuppressions.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    auto [it, inserted] = gSuppressions.try_emplace(std::string(text));
+    if (!inserted && timestampNs - it->second.lastEmitNs < windowNs) {
+        it->second.suppressed++;
+        return false;
+    }
+
+    suppressed = it->second.suppressed;
+    it->second.level = level;
+    it->second.lastEmitNs = timestampNs;
+    it->second.suppressed = 0;
+    return true;
+}
+
+// 取出当前所有已发布的消息，返回处理条数
+size_t drain() {
+    Ring& ring = *gRing;
+    size_t count = 0;
+
+    while (true) {
+        Slot& slot = ring.slots[ring.dequeuePos & (kCapacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != ring.dequeuePos + 1) {
+            break;
+        }
+
+        std::string_view text(slot.text, slot.length);
+        uint64_t suppressed = 0;
+        if (admit(slot.level, slot.timestampNs, text, suppressed)) {
+            emit(slot.level, slot.timestampNs, text, suppressed);
+        }
+
+        slot.sequence.store(ring.dequeuePos + kCapacity, std::memory_order_release);
+        ring.dequeuePos++;
+        count++;
+    }
+    return count;
+}
+
+void writerLoop() {
+    auto backoff = std::chrono::microseconds(200);
+
+    while (true) {
+        if (drain() > 0) {
+            // 一批消息写完后统一刷新
+            std::fflush(stdout);
+            std::fflush(stderr);
+            backoff = std::chrono::microseconds(200);
+            continue;
+        }
+
+        // 已申请但尚未发布的槽位也要等待写完
+        bool empty = gRing->enqueuePos.load(std::memory_order_acquire) == gRing->dequeuePos;
+        if (empty && gStopRequested.load(std::memory_order_acquire)) {
+            break;
+        }
+
+        std::this_thread::sleep_for(backoff);
+        backoff = std::min(backoff * 2, std::chrono::microseconds(10000));
+    }
+
+    // 补报仍处于抑制窗口内的重复消息
+    int64_t now = nowNs();
+    for (const auto& [text, state] : gSuppressions) {
+        if (state.suppressed > 0) {
+            emit(state.level, now, text, state.suppressed);
+        }
+    }
+    gSuppressions.clear();
+
+    std::fflush(stdout);
+    std::fflush(stderr);
+}
+
+void start() {
+    gRing = std::make_unique<Ring>();
+    gRunning.store(true, std::memory_order_release);
+    gWriter = std::thread(writerLoop);
+    std::atexit(Logger::shutdown);
+}
+
+} // namespace
+
+Logger::Line::~Line() {
+    if (enabled_) {
+        submit(level_, buffer_, length_);
+    }
+}
+
+Logger::Line& Logger::Line::operator<<(std::string_view text) {
+    if (!enabled_) {
+        return *this;
+    }
+
+    size_t room = kMaxMessage - length_;
+    size_t n = std::min(room, text.size());
+    if (n < text.size()) {
+        // 截断时退回到UTF-8字符边界
+        while (n > 0 && (static_cast<unsigned char>(text[n]) & 0xC0) == 0x80) {
+            --n;
+        }
+    }
+    std::memcpy(buffer_ + length_, text.data(), n);
+    length_ += n;
+    return *this;
+}
+
+Logger::Line& Logger::Line::operator<<(double value) {
+    if (enabled_) {
+        auto result = std::to_chars(buffer_ + length_, buffer_ + kMaxMessage, value,
+                                    std::chars_format::fixed, 3);
+        if (result.ec == std::errc()) {
+            length_ = static_cast<size_t>(result.ptr - buffer_);
+        }
+    }
+    return *this;
+}
+
+void Logger::configure(const Options& options) {
+    gLevel.store(static_cast<int>(options.level), std::memory_order_relaxed);
+    gFormat.store(static_cast<int>(options.format), std::memory_order_relaxed);
+    gRateLimitSeconds.store(options.rate_limit_seconds, std::memory_order_relaxed);
+}
+
+Logger::Level Logger::parseLevel(const std::string& name) {
+    if (name == "debug") return Level::Debug;
+    if (name == "warn" || name == "warning") return Level::Warn;
+    if (name == "error") return Level::Error;
+    return Level::Info;
+}
+
+bool Logger::enabled(Level level) {
+    return static_cast<int>(level) >= gLevel.load(std::memory_order_relaxed);
+}
+
+void Logger::submit(Level level, const char* text, size_t length) {
+    std::call_once(gStartOnce, start);
+
+    // 先登记再检查运行状态：shutdown 清除运行状态后会等登记的生产者发布完，才让后台线程退出
+    gProducers.fetch_add(1);
+    if (!gRunning.load()) {
+        gProducers.fetch_sub(1);
+        // 后台线程已停止（退出阶段），直接同步输出
+        std::lock_guard<std::mutex> lock(gDirectMutex);
+        emit(level, nowNs(), std::string_view(text, length), 0);
+        std::fflush(level >= Level::Warn ? stderr : stdout);
+        return;
+    }
+
+    Ring& ring = *gRing;
+    uint64_t pos = ring.enqueuePos.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+
+    while (true) {
+        slot = &ring.slots[pos & (kCapacity - 1)];
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+
+        if (diff == 0) {
+            if (ring.enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // 缓冲区已满，等待后台线程腾出空间（不丢弃消息）
+            std::this_thread::yield();
+            pos = ring.enqueuePos.load(std::memory_order_relaxed);
+        } else {
+            pos = ring.enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    slot->timestampNs = nowNs();
+    slot->length = static_cast<uint32_t>(length);
+    std::memcpy(slot->text, text, length);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    gProducers.fetch_sub(1, std::memory_order_release);
+}
+
+void Logger::shutdown() {
+    if (!gRunning.exchange(false)) {
+        return;
+    }
+    // 等待已通过运行状态检查的生产者发布完消息，之后的消息都会直接输出
+    while (gProducers.load() != 0) {
+        std::this_thread::yield();
+    }
+    gStopRequested.store(true, std::memory_order_release);
+    if (gWriter.joinable()) {
+        gWriter.join();
+    }
+}
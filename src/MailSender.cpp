@@ -2,8 +2,18 @@
 // Created by athbe on 2025/6/17.
 //
 #include "MailSender.h"
-#include <iostream>
+#include "Logger.h"
+#include "Tracer.h"
+#include "CurlGlobal.h"
+#include "HostHealth.h"
+#include "RateLimiter.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <mutex>
 #include <sstream>
+#include <thread>
 #include <stdexcept>
 #include <cstring>
 
@@ -24,11 +34,7 @@ static size_t read_callback(void *ptr, size_t size, size_t nmemb, void *userp) {
 
 // 初始化全局CURL环境（线程安全）
 void MailSender::globalInit() {
-    static bool initialized = false;
-    if (!initialized) {
-        curl_global_init(CURL_GLOBAL_DEFAULT);
-        initialized = true;
-    }
+    CurlGlobal::ensureInit();
 }
 
 // 清理全局CURL环境
@@ -89,7 +95,7 @@ bool MailSender::send(const SmtpConfig& config,
     // 初始化CURL会话
     CURL *curl = curl_easy_init();
     if (!curl) {
-        std::cerr << "Failed to initialize CURL" << std::endl;
+        Logger::error() << "Failed to initialize CURL";
         return false;
     }
 
@@ -102,25 +108,14 @@ bool MailSender::send(const SmtpConfig& config,
     return result;
 }
 
-bool MailSender::performSend(CURL* curl,
-                            const SmtpConfig& config,
-                            const std::vector<std::string>& recipients,
-                            const std::string& email_text) {
-    CURLcode res = CURLE_OK;
-    struct curl_slist *recipient_list = nullptr;
-
-    // 设置收件人列表
-    for (const auto& recipient : recipients) {
-        recipient_list = curl_slist_append(recipient_list, recipient.c_str());
-    }
-
-    // 复制邮件内容，因为回调函数会修改字符串
-    std::string email_copy = email_text;
-
+void MailSender::configureHandle(CURL* curl,
+                                 const SmtpConfig& config,
+                                 curl_slist* recipient_list,
+                                 std::string* email_text) {
     // 设置服务器地址和端口
     std::string url = (config.useSsl ? "smtps://" : "smtp://") + config.server;
     curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_PORT, config.port);
+    curl_easy_setopt(curl, CURLOPT_PORT, static_cast<long>(config.port));
 
     // 设置用户名和密码
     curl_easy_setopt(curl, CURLOPT_USERNAME, config.username.c_str());
@@ -134,7 +129,7 @@ bool MailSender::performSend(CURL* curl,
 
     // 设置邮件内容回调函数
     curl_easy_setopt(curl, CURLOPT_READFUNCTION, read_callback);
-    curl_easy_setopt(curl, CURLOPT_READDATA, &email_copy);
+    curl_easy_setopt(curl, CURLOPT_READDATA, email_text);
     curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
 
     // SSL/TLS 配置
@@ -149,6 +144,7 @@ bool MailSender::performSend(CURL* curl,
 
     // 设置超时
     curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
 
     // 启用TCP保活
     curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
@@ -157,18 +153,310 @@ bool MailSender::performSend(CURL* curl,
 
     // 开启详细日志（调试时使用）
     // curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
+}
+
+bool MailSender::performSend(CURL* curl,
+                            const SmtpConfig& config,
+                            const std::vector<std::string>& recipients,
+                            const std::string& email_text) {
+    CURLcode res = CURLE_OK;
+    struct curl_slist *recipient_list = nullptr;
+
+    // 设置收件人列表
+    for (const auto& recipient : recipients) {
+        recipient_list = curl_slist_append(recipient_list, recipient.c_str());
+    }
+
+    // 复制邮件内容，因为回调函数会修改字符串
+    std::string email_copy = email_text;
+    configureHandle(curl, config, recipient_list, &email_copy);
 
     // 执行发送
+    int64_t startUs = Tracer::nowUs();
     res = curl_easy_perform(curl);
+    Tracer::recordCurlTimings(curl, startUs);
 
     // 清理收件人列表
     curl_slist_free_all(recipient_list);
 
     // 检查结果
     if (res != CURLE_OK) {
-        std::cerr << "Mail sending failed: " << curl_easy_strerror(res) << std::endl;
+        Logger::error() << "Mail sending failed: " << curl_easy_strerror(res);
         return false;
     }
 
     return true;
 }
+
+std::vector<MailSender::Result> MailSender::sendBatch(const std::vector<SmtpConfig>& relays,
+                                                      const std::vector<Message>& messages,
+                                                      std::chrono::steady_clock::time_point startBy,
+                                                      std::chrono::steady_clock::time_point finishBy) {
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<Result> results(messages.size());
+    if (messages.empty()) {
+        return results;
+    }
+    if (relays.empty()) {
+        for (auto& result : results) {
+            result.error = "未配置SMTP中继";
+        }
+        return results;
+    }
+
+    globalInit();
+
+    struct Relay {
+        const SmtpConfig* config = nullptr;
+        std::string key;      // 熔断和限流的键：smtp:服务器:端口
+        std::string name;     // 服务器:端口
+        HostHealth* health = nullptr;
+        int held = 0;         // 工作线程持有的连接数（不超过 maxConnections）
+    };
+    std::vector<Relay> relayStates;
+    relayStates.reserve(relays.size());
+    int slots = 0;
+    for (const auto& config : relays) {
+        Relay relay;
+        relay.config = &config;
+        relay.key = "smtp:" + config.server + ":" + std::to_string(config.port);
+        relay.name = config.server + ":" + std::to_string(config.port);
+        relay.health = &HostHealth::forHost(relay.key);
+        relayStates.push_back(std::move(relay));
+        slots += std::max(1, config.maxConnections);
+    }
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::list<size_t> queue;
+    for (size_t i = 0; i < messages.size(); ++i) {
+        queue.push_back(i);
+    }
+    // tried[i][r]：邮件i是否已经在中继r上失败过
+    std::vector<std::vector<char>> tried(messages.size(), std::vector<char>(relays.size(), 0));
+    int inFlight = 0;
+
+    // 每个工作线程驱动一条SMTP连接，连续发送多封邮件复用同一连接
+    auto worker = [&]() {
+        CURL* curl = nullptr;
+        size_t mine = relays.size();  // 当前连接所属的中继，尚未连接时为 relays.size()
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            // 不再开始新的发送：剩余邮件留给调用方稍后重试
+            if (!queue.empty() && Clock::now() >= startBy) {
+                for (size_t remaining : queue) {
+                    results[remaining].deferred = true;
+                    results[remaining].error = "截止时间前未能发送";
+                }
+                queue.clear();
+                changed.notify_all();
+            }
+
+            // 取第一封可以发出的邮件，为其选择 已持有连接数/权重 最小的中继；已连接的中继优先
+            size_t index = 0;
+            size_t chosen = relays.size();
+            bool throttled = false;
+            bool capped = false;  // 有未尝试的中继因连接数已满被跳过
+            for (auto it = queue.begin(); it != queue.end() && chosen == relays.size();) {
+                index = *it;
+                bool untried = false;
+                std::vector<char> skipped(relays.size(), 0);
+                while (true) {
+                    size_t best = relays.size();
+                    long long bestLoad = 0;
+                    long long bestWeight = 1;
+                    for (size_t r = 0; r < relayStates.size(); ++r) {
+                        const Relay& relay = relayStates[r];
+                        if (tried[index][r]) continue;
+                        untried = true;
+                        long long others = relay.held - (r == mine ? 1 : 0);
+                        if (skipped[r]) continue;
+                        if (others >= std::max(1, relay.config->maxConnections)) {
+                            capped = true;
+                            continue;
+                        }
+                        // 交叉相乘比较 others/weight；相同时优先复用已有连接，其次选权重大的中继
+                        long long weight = std::max(1, relay.config->weight);
+                        bool better = best == relays.size() || others * bestWeight < bestLoad * weight;
+                        if (!better && others * bestWeight == bestLoad * weight && best != mine) {
+                            better = r == mine || weight > bestWeight;
+                        }
+                        if (better) {
+                            best = r;
+                            bestLoad = others;
+                            bestWeight = weight;
+                        }
+                    }
+                    if (best == relays.size()) break;
+
+                    // 熔断冷却中的中继直接跳过；限流令牌不足时稍后再试
+                    Relay& relay = relayStates[best];
+                    if (relay.health->retryAfter().count() > 0) {
+                        skipped[best] = 1;
+                    } else if (!RateLimiter::tryAcquire(relay.key)) {
+                        throttled = true;
+                        skipped[best] = 1;
+                    } else if (!relay.health->allowRequest()) {
+                        skipped[best] = 1;
+                    } else {
+                        chosen = best;
+                        break;
+                    }
+                }
+
+                if (chosen != relays.size()) {
+                    queue.erase(it);
+                } else if (!untried) {
+                    // 所有中继都已失败过
+                    if (results[index].error.empty()) {
+                        results[index].error = "所有SMTP中继均发送失败";
+                    }
+                    it = queue.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+
+            if (chosen == relays.size()) {
+                if (queue.empty() && inFlight == 0) {
+                    break;
+                }
+                if (inFlight == 0 && !throttled && !capped) {
+                    // 剩余邮件可用的中继全部处于熔断状态
+                    for (size_t remaining : queue) {
+                        if (results[remaining].error.empty()) {
+                            results[remaining].error = "SMTP中继熔断中";
+                        }
+                    }
+                    queue.clear();
+                    changed.notify_all();
+                    break;
+                }
+                // 空闲时让出连接名额，其他线程才能把失败的邮件转到本连接的中继上重发；
+                // 只是等待限流令牌时保留连接，令牌补充后继续复用
+                if (!throttled && mine != relays.size()) {
+                    relayStates[mine].held--;
+                    mine = relays.size();
+                    changed.notify_all();
+                    // 关闭连接（发送QUIT）时不持有锁
+                    CURL* idle = curl;
+                    curl = nullptr;
+                    lock.unlock();
+                    if (idle) {
+                        curl_easy_cleanup(idle);
+                    }
+                    lock.lock();
+                    continue;
+                }
+                // 等待其他连接完成（失败的邮件会重新排队）或限流令牌补充
+                changed.wait_for(lock, std::chrono::milliseconds(throttled ? 20 : 200));
+                continue;
+            }
+
+            // 换中继时关闭原连接，保证每个中继的连接数不超过上限
+            if (chosen != mine) {
+                if (mine != relays.size()) {
+                    relayStates[mine].held--;
+                }
+                if (curl) {
+                    curl_easy_cleanup(curl);
+                    curl = nullptr;
+                }
+                mine = chosen;
+                relayStates[mine].held++;
+            }
+            Relay& relay = relayStates[mine];
+            Result& result = results[index];
+            result.attempts++;
+            result.relay = relay.name;
+            inFlight++;
+            lock.unlock();
+
+            // 发送过程不持有锁
+            const Message& message = messages[index];
+            if (!curl) {
+                curl = curl_easy_init();
+            }
+            CURLcode code = CURLE_FAILED_INIT;
+            long response = 0;
+            auto begin = Clock::now();
+            if (curl) {
+                curl_slist* recipients = curl_slist_append(nullptr, message.recipient.c_str());
+                std::string payload = buildEmailHeader(relay.config->username, {message.recipient}, message.subject) +
+                                      message.body + "\r\n";
+                configureHandle(curl, *relay.config, recipients, &payload);
+                if (finishBy != Clock::time_point::max()) {
+                    // 传输不能超过截止时间（仍不超过默认的30秒）
+                    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(finishBy - Clock::now());
+                    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS,
+                                     static_cast<long>(std::clamp<int64_t>(remaining.count(), 1, 30000)));
+                }
+
+                int64_t startUs = Tracer::nowUs();
+                code = curl_easy_perform(curl);
+                Tracer::recordCurlTimings(curl, startUs);
+                curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response);
+                curl_slist_free_all(recipients);
+            }
+            auto latency = std::chrono::duration_cast<HostHealth::Millis>(Clock::now() - begin);
+
+            lock.lock();
+            inFlight--;
+            if (code == CURLE_OK) {
+                relay.health->recordSuccess(latency);
+                result.ok = true;
+                result.error.clear();
+            } else if (code == CURLE_OPERATION_TIMEDOUT && Clock::now() >= finishBy) {
+                // 被截止时间中止，与中继的健康状况无关；连接状态未知，丢弃
+                result.deferred = true;
+                result.error = "截止时间前未完成发送";
+                curl_easy_cleanup(curl);
+                curl = nullptr;
+                relay.held--;
+                mine = relays.size();
+            } else if (response == 550 || response == 551 || response == 553) {
+                // 收件人被拒绝：中继本身正常，换中继也无济于事
+                relay.health->recordSuccess(latency);
+                result.permanent = true;
+                result.error = "收件人被拒绝 (" + std::to_string(response) + ")";
+            } else {
+                // 连接、认证或服务器错误：丢弃该连接，换一个中继重发
+                relay.health->recordFailure();
+                result.error = relay.name + ": " + curl_easy_strerror(code);
+                if (response > 0) {
+                    result.error += " (" + std::to_string(response) + ")";
+                }
+                tried[index][mine] = 1;
+                queue.push_front(index);
+                if (curl) {
+                    curl_easy_cleanup(curl);
+                    curl = nullptr;
+                }
+                relay.held--;
+                mine = relays.size();
+            }
+            changed.notify_all();
+        }
+
+        if (mine != relays.size()) {
+            relayStates[mine].held--;
+        }
+        lock.unlock();
+        if (curl) {
+            curl_easy_cleanup(curl);
+        }
+    };
+
+    size_t workers = std::min<size_t>(static_cast<size_t>(slots), messages.size());
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+    for (size_t i = 0; i < workers; ++i) {
+        threads.emplace_back(worker);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return results;
+}
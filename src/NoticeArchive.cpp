@@ -0,0 +1,409 @@
+//
+// Created by athbe on 2026/10/18.
+//
+#include "NoticeArchive.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// 各列文件名
+constexpr const char* kNnidFile = "nnid.col";
+constexpr const char* kEpochFile = "epoch.col";
+constexpr const char* kProgramaFile = "programa.col";
+constexpr const char* kTitleFile = "title.col";
+constexpr const char* kSynopsisFile = "synopsis.col";
+constexpr const char* kStringDataFile = "strings.dat";
+constexpr const char* kStringEndFile = "strings.idx";
+constexpr const char* kBlockFile = "time.idx";
+constexpr const char* kLockFile = ".lock";
+
+int openColumn(const std::string& dir, const char* name) {
+    std::string path = dir + "/" + name;
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("无法打开归档文件: " + path + ": " + std::strerror(errno));
+    }
+    return fd;
+}
+
+size_t fileSize(int fd) {
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        return 0;
+    }
+    return static_cast<size_t>(st.st_size);
+}
+
+void writeAll(int fd, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = ::write(fd, bytes + written, size - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("写入归档失败: " + std::string(std::strerror(errno)));
+        }
+        written += static_cast<size_t>(n);
+    }
+}
+
+// 只读映射文件的前 size 字节，size为0时返回nullptr
+const char* mapPrefix(int fd, size_t size) {
+    if (size == 0) {
+        return nullptr;
+    }
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("无法映射归档文件: " + std::string(std::strerror(errno)));
+    }
+    return static_cast<const char*>(data);
+}
+
+void unmapPrefix(const void* data, size_t size) {
+    if (data) {
+        ::munmap(const_cast<void*>(data), size);
+    }
+}
+
+// 定长列的只读映射，离开作用域时解除
+template <typename T>
+class ColumnView {
+public:
+    ColumnView(int fd, size_t rows)
+        : data_(reinterpret_cast<const T*>(mapPrefix(fd, rows * sizeof(T)))), size_(rows * sizeof(T)) {}
+    ~ColumnView() { unmapPrefix(data_, size_); }
+
+    ColumnView(const ColumnView&) = delete;
+    ColumnView& operator=(const ColumnView&) = delete;
+
+    T operator[](size_t index) const { return data_[index]; }
+
+private:
+    const T* data_;
+    size_t size_;
+};
+
+void closeFd(int& fd) {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+} // namespace
+
+NoticeArchive::NoticeArchive(const std::string& dir) : dir_(dir) {
+    std::filesystem::create_directories(dir_);
+
+    // 每个写入者有各自的字符串池和去重集合，多个进程同时追加会使各列错位
+    lockFd_ = openColumn(dir_, kLockFile);
+    if (::flock(lockFd_, LOCK_EX | LOCK_NB) != 0) {
+        closeFd(lockFd_);
+        throw std::runtime_error("归档正被其他进程写入: " + dir_);
+    }
+
+    try {
+        nnidFd_ = openColumn(dir_, kNnidFile);
+        epochFd_ = openColumn(dir_, kEpochFile);
+        programaFd_ = openColumn(dir_, kProgramaFile);
+        titleFd_ = openColumn(dir_, kTitleFile);
+        synopsisFd_ = openColumn(dir_, kSynopsisFile);
+        stringDataFd_ = openColumn(dir_, kStringDataFile);
+        stringEndFd_ = openColumn(dir_, kStringEndFile);
+        blockFd_ = openColumn(dir_, kBlockFile);
+
+        recover();
+    } catch (...) {
+        // 构造失败时析构函数不会执行，释放已打开的文件和锁
+        closeFiles();
+        throw;
+    }
+}
+
+NoticeArchive::~NoticeArchive() {
+    closeFiles();
+}
+
+void NoticeArchive::closeFiles() {
+    closeFd(nnidFd_);
+    closeFd(epochFd_);
+    closeFd(programaFd_);
+    closeFd(titleFd_);
+    closeFd(synopsisFd_);
+    closeFd(stringDataFd_);
+    closeFd(stringEndFd_);
+    closeFd(blockFd_);
+    closeFd(lockFd_);
+
+    unmapPrefix(poolEnds_, poolCount_ * sizeof(uint64_t));
+    unmapPrefix(poolData_, poolBytes_);
+    poolEnds_ = nullptr;
+    poolData_ = nullptr;
+}
+
+void NoticeArchive::recover() {
+    // 各列行数可能因崩溃而不一致，以最短的列为准
+    rows_ = std::min({
+        fileSize(nnidFd_) / sizeof(int64_t),
+        fileSize(epochFd_) / sizeof(int64_t),
+        fileSize(programaFd_) / sizeof(uint32_t),
+        fileSize(titleFd_) / sizeof(uint32_t),
+        fileSize(synopsisFd_) / sizeof(uint32_t)
+    });
+    ::ftruncate(nnidFd_, static_cast<off_t>(rows_ * sizeof(int64_t)));
+    ::ftruncate(epochFd_, static_cast<off_t>(rows_ * sizeof(int64_t)));
+    ::ftruncate(programaFd_, static_cast<off_t>(rows_ * sizeof(uint32_t)));
+    ::ftruncate(titleFd_, static_cast<off_t>(rows_ * sizeof(uint32_t)));
+    ::ftruncate(synopsisFd_, static_cast<off_t>(rows_ * sizeof(uint32_t)));
+
+    // 恢复字符串池：只校验末尾的结束偏移，字符串内容留在映射中，首次追加时才建立索引
+    size_t dataSize = fileSize(stringDataFd_);
+    stringCount_ = fileSize(stringEndFd_) / sizeof(uint64_t);
+    stringBytes_ = 0;
+    while (stringCount_ > 0) {
+        uint64_t end = 0;
+        off_t offset = static_cast<off_t>((stringCount_ - 1) * sizeof(end));
+        if (::pread(stringEndFd_, &end, sizeof(end), offset) == static_cast<ssize_t>(sizeof(end)) && end <= dataSize) {
+            stringBytes_ = end;
+            break;
+        }
+        stringCount_--;
+    }
+    ::ftruncate(stringEndFd_, static_cast<off_t>(stringCount_ * sizeof(uint64_t)));
+    ::ftruncate(stringDataFd_, static_cast<off_t>(stringBytes_));
+
+    poolEnds_ = reinterpret_cast<const uint64_t*>(mapPrefix(stringEndFd_, stringCount_ * sizeof(uint64_t)));
+    poolCount_ = stringCount_;
+    poolData_ = mapPrefix(stringDataFd_, stringBytes_);
+    poolBytes_ = stringBytes_;
+
+    // 恢复去重集合，并重建区块索引
+    ColumnView<int64_t> nnids(nnidFd_, rows_);
+    ColumnView<int64_t> epochs(epochFd_, rows_);
+    ColumnView<uint32_t> programas(programaFd_, rows_);
+    ColumnView<uint32_t> titles(titleFd_, rows_);
+    ColumnView<uint32_t> synopses(synopsisFd_, rows_);
+
+    std::vector<int64_t> blocks;
+    rowKeys_.reserve(rows_);
+    for (size_t i = 0; i < rows_; ++i) {
+        rowKeys_.insert(rowKey(nnids[i], programas[i], titles[i], synopses[i]));
+
+        if (i % kBlockRows == 0) {
+            blockMin_ = blockMax_ = epochs[i];
+        } else {
+            blockMin_ = std::min(blockMin_, epochs[i]);
+            blockMax_ = std::max(blockMax_, epochs[i]);
+        }
+        if ((i + 1) % kBlockRows == 0) {
+            blocks.push_back(blockMin_);
+            blocks.push_back(blockMax_);
+        }
+    }
+
+    if (fileSize(blockFd_) != blocks.size() * sizeof(int64_t)) {
+        ::ftruncate(blockFd_, 0);
+        writeAll(blockFd_, blocks.data(), blocks.size() * sizeof(int64_t));
+    }
+}
+
+uint64_t NoticeArchive::rowKey(long long nnid, uint32_t programa, uint32_t title, uint32_t synopsis) {
+    uint64_t key = static_cast<uint64_t>(nnid) * 0x9e3779b97f4a7c15ULL;
+    for (uint64_t part : {uint64_t{programa}, uint64_t{title}, uint64_t{synopsis}}) {
+        key ^= part + 0x9e3779b97f4a7c15ULL + (key << 6) + (key >> 2);
+    }
+    return key;
+}
+
+void NoticeArchive::indexStrings() {
+    strings_.reserve(poolCount_);
+    uint64_t begin = 0;
+    for (size_t id = 0; id < poolCount_; ++id) {
+        uint64_t end = poolEnds_[id];
+        strings_.emplace(std::string_view(poolData_ + begin, end - begin), static_cast<uint32_t>(id));
+        begin = end;
+    }
+    stringsIndexed_ = true;
+}
+
+uint32_t NoticeArchive::intern(const std::string& text) {
+    if (!stringsIndexed_) {
+        indexStrings();
+    }
+
+    auto it = strings_.find(text);
+    if (it != strings_.end()) {
+        return it->second;
+    }
+
+    // 先写字符串内容，再写结束偏移，崩溃时不会出现指向无效数据的ID
+    writeAll(stringDataFd_, text.data(), text.size());
+    stringBytes_ += text.size();
+    writeAll(stringEndFd_, &stringBytes_, sizeof(stringBytes_));
+
+    auto id = static_cast<uint32_t>(stringCount_++);
+    strings_.emplace(added_.emplace_back(text), id);
+    return id;
+}
+
+bool NoticeArchive::append(const Notice& notice) {
+    uint32_t programa = intern(notice.programaName);
+    uint32_t title = intern(notice.title);
+    uint32_t synopsis = intern(notice.synopsis);
+
+    if (!rowKeys_.insert(rowKey(notice.nnid, programa, title, synopsis)).second) {
+        return false;
+    }
+
+    int64_t nnid = notice.nnid;
+    int64_t epoch = parseTime(notice.creatTime);
+    writeAll(nnidFd_, &nnid, sizeof(nnid));
+    writeAll(epochFd_, &epoch, sizeof(epoch));
+    writeAll(programaFd_, &programa, sizeof(programa));
+    writeAll(titleFd_, &title, sizeof(title));
+    writeAll(synopsisFd_, &synopsis, sizeof(synopsis));
+
+    // 更新当前区块的时间范围，区块写满时落到索引文件
+    if (rows_ % kBlockRows == 0) {
+        blockMin_ = blockMax_ = epoch;
+    } else {
+        blockMin_ = std::min(blockMin_, epoch);
+        blockMax_ = std::max(blockMax_, epoch);
+    }
+    rows_++;
+    if (rows_ % kBlockRows == 0) {
+        int64_t block[2] = {blockMin_, blockMax_};
+        writeAll(blockFd_, block, sizeof(block));
+    }
+    return true;
+}
+
+int64_t NoticeArchive::parseTime(const std::string& utc_time) {
+    std::tm tm = {};
+    std::istringstream ss(utc_time);
+    ss >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S");
+    if (ss.fail()) {
+        return 0;
+    }
+    return static_cast<int64_t>(timegm(&tm));
+}
+
+NoticeArchive::Reader::Reader(const std::string& dir) {
+    for (const char* name : {kNnidFile, kEpochFile, kProgramaFile, kTitleFile,
+                             kSynopsisFile, kStringEndFile, kStringDataFile, kBlockFile}) {
+        mappings_.push_back(map(dir + "/" + name));
+    }
+
+    nnids_ = reinterpret_cast<const int64_t*>(mappings_[0].data);
+    epochs_ = reinterpret_cast<const int64_t*>(mappings_[1].data);
+    programas_ = reinterpret_cast<const uint32_t*>(mappings_[2].data);
+    titles_ = reinterpret_cast<const uint32_t*>(mappings_[3].data);
+    synopses_ = reinterpret_cast<const uint32_t*>(mappings_[4].data);
+    stringEnds_ = reinterpret_cast<const uint64_t*>(mappings_[5].data);
+    stringData_ = mappings_[6].data;
+    blocks_ = reinterpret_cast<const int64_t*>(mappings_[7].data);
+
+    rows_ = std::min({
+        mappings_[0].size / sizeof(int64_t),
+        mappings_[1].size / sizeof(int64_t),
+        mappings_[2].size / sizeof(uint32_t),
+        mappings_[3].size / sizeof(uint32_t),
+        mappings_[4].size / sizeof(uint32_t)
+    });
+    stringCount_ = mappings_[5].size / sizeof(uint64_t);
+    blockCount_ = std::min(mappings_[7].size / (2 * sizeof(int64_t)), rows_ / kBlockRows);
+}
+
+NoticeArchive::Reader::~Reader() {
+    for (const auto& mapping : mappings_) {
+        if (mapping.data) {
+            ::munmap(const_cast<char*>(mapping.data), mapping.size);
+        }
+    }
+}
+
+NoticeArchive::Reader::Mapping NoticeArchive::Reader::map(const std::string& path) {
+    Mapping mapping;
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return mapping;
+        }
+        throw std::runtime_error("无法打开归档文件: " + path + ": " + std::strerror(errno));
+    }
+
+    size_t size = fileSize(fd);
+    if (size > 0) {
+        void* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("无法映射归档文件: " + path + ": " + std::strerror(errno));
+        }
+        // 顺序扫描为主
+        ::madvise(data, size, MADV_SEQUENTIAL);
+        mapping.data = static_cast<const char*>(data);
+        mapping.size = size;
+    }
+    ::close(fd);
+    return mapping;
+}
+
+std::string_view NoticeArchive::Reader::string(uint32_t id) const {
+    if (id >= stringCount_) {
+        return {};
+    }
+    uint64_t begin = id == 0 ? 0 : stringEnds_[id - 1];
+    uint64_t end = stringEnds_[id];
+    if (end > mappings_[6].size || begin > end) {
+        return {};
+    }
+    return {stringData_ + begin, static_cast<size_t>(end - begin)};
+}
+
+NoticeArchive::Row NoticeArchive::Reader::row(size_t index) const {
+    Row row;
+    row.nnid = nnids_[index];
+    row.epoch = epochs_[index];
+    row.programa = string(programas_[index]);
+    row.title = string(titles_[index]);
+    row.synopsis = string(synopses_[index]);
+    return row;
+}
+
+std::vector<std::pair<size_t, size_t>> NoticeArchive::Reader::candidateRanges(int64_t from, int64_t to) const {
+    std::vector<std::pair<size_t, size_t>> ranges;
+
+    auto add = [&ranges](size_t begin, size_t end) {
+        if (!ranges.empty() && ranges.back().second == begin) {
+            ranges.back().second = end;
+        } else {
+            ranges.emplace_back(begin, end);
+        }
+    };
+
+    // 完整区块按时间范围过滤
+    for (size_t block = 0; block < blockCount_; ++block) {
+        int64_t min = blocks_[block * 2];
+        int64_t max = blocks_[block * 2 + 1];
+        if (max < from || min > to) continue;
+        add(block * kBlockRows, (block + 1) * kBlockRows);
+    }
+
+    // 末尾未写满的区块总是扫描
+    if (blockCount_ * kBlockRows < rows_) {
+        add(blockCount_ * kBlockRows, rows_);
+    }
+    return ranges;
+}
@@ -0,0 +1,184 @@
+//
+// Created by athbe on 2026/10/18.
+//
+#include "NoticeSnapshot.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace {
+
+constexpr uint64_t kFnvOffset = 1469598103934665603ULL;
+constexpr uint64_t kFnvPrime = 1099511628211ULL;
+
+void fnvMix(uint64_t& hash, const std::string& text) {
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= kFnvPrime;
+    }
+    // 字段分隔符，避免 "ab"+"c" 与 "a"+"bc" 冲突
+    hash ^= 0xff;
+    hash *= kFnvPrime;
+}
+
+// 快照文件格式：魔数、条目数，之后每条为 nnid、哈希和五个带长度前缀的字符串
+// LQS1 没有链接字段，读取时兼容
+constexpr char kSnapshotMagic[4] = {'L', 'Q', 'S', '2'};
+constexpr char kSnapshotMagicV1[4] = {'L', 'Q', 'S', '1'};
+
+void writeString(std::ostream& out, const std::string& text) {
+    uint32_t length = static_cast<uint32_t>(text.size());
+    out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.write(text.data(), length);
+}
+
+bool readString(std::istream& in, std::string& text) {
+    uint32_t length = 0;
+    if (!in.read(reinterpret_cast<char*>(&length), sizeof(length))) {
+        return false;
+    }
+    text.resize(length);
+    return static_cast<bool>(in.read(text.data(), length));
+}
+
+} // namespace
+
+uint64_t NoticeSnapshot::contentHash(const Notice& notice) {
+    uint64_t hash = kFnvOffset;
+    fnvMix(hash, notice.title);
+    fnvMix(hash, notice.synopsis);
+    fnvMix(hash, notice.programaName);
+    return hash;
+}
+
+std::vector<NoticeEvent> NoticeSnapshot::diff(const std::vector<Notice>& current) const {
+    std::vector<NoticeEvent> events;
+
+    // 空列表多半是接口异常，保留原快照
+    if (current.empty()) {
+        return events;
+    }
+
+    std::string oldestPresent;
+    std::unordered_set<long long> present;
+    present.reserve(current.size());
+    for (const auto& notice : current) {
+        if (oldestPresent.empty() || (!notice.creatTime.empty() && notice.creatTime < oldestPresent)) {
+            oldestPresent = notice.creatTime;
+        }
+        present.insert(notice.nnid);
+
+        auto it = entries_.find(notice.nnid);
+        if (it == entries_.end()) {
+            events.push_back({NoticeEvent::Kind::New, notice});
+        } else if (it->second.notice.hash != notice.hash) {
+            events.push_back({NoticeEvent::Kind::Edited, notice});
+        }
+    }
+
+    // 本次未出现的条目：删除或被翻页移出
+    for (const auto& [nnid, entry] : entries_) {
+        if (!present.count(nnid) && entry.notice.creatTime >= oldestPresent) {
+            events.push_back({NoticeEvent::Kind::Removed, entry.notice});
+        }
+    }
+
+    return events;
+}
+
+void NoticeSnapshot::apply(const std::vector<Notice>& current) {
+    if (current.empty()) {
+        return;
+    }
+    const uint64_t generation = ++generation_;
+
+    for (const auto& notice : current) {
+        Entry& entry = entries_[notice.nnid];
+        if (entry.notice.hash != notice.hash || entry.notice.nnid != notice.nnid) {
+            entry.notice = notice;
+        }
+        entry.generation = generation;
+    }
+
+    // 本次未出现的条目（无论删除还是翻页移出）都不再保留
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->second.generation == generation) {
+            ++it;
+        } else {
+            it = entries_.erase(it);
+        }
+    }
+}
+
+bool NoticeSnapshot::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    char magic[4] = {};
+    uint32_t count = 0;
+    if (!in.read(magic, sizeof(magic)) ||
+        (std::memcmp(magic, kSnapshotMagic, sizeof(magic)) != 0 &&
+         std::memcmp(magic, kSnapshotMagicV1, sizeof(magic)) != 0) ||
+        !in.read(reinterpret_cast<char*>(&count), sizeof(count))) {
+        return false;
+    }
+    const bool hasLink = std::memcmp(magic, kSnapshotMagic, sizeof(magic)) == 0;
+
+    std::unordered_map<long long, Entry> entries;
+    entries.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        Notice notice;
+        int64_t nnid = 0;
+        if (!in.read(reinterpret_cast<char*>(&nnid), sizeof(nnid)) ||
+            !in.read(reinterpret_cast<char*>(&notice.hash), sizeof(notice.hash)) ||
+            !readString(in, notice.creatTime) ||
+            !readString(in, notice.title) ||
+            !readString(in, notice.programaName) ||
+            !readString(in, notice.synopsis) ||
+            (hasLink && !readString(in, notice.link))) {
+            return false;
+        }
+        notice.nnid = nnid;
+        entries[notice.nnid].notice = std::move(notice);
+    }
+
+    entries_ = std::move(entries);
+    return true;
+}
+
+void NoticeSnapshot::save(const std::string& path) const {
+    std::filesystem::path p(path);
+    if (p.has_parent_path()) {
+        std::filesystem::create_directories(p.parent_path());
+    }
+
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("无法写入快照: " + tmpPath);
+        }
+
+        uint32_t count = static_cast<uint32_t>(entries_.size());
+        out.write(kSnapshotMagic, sizeof(kSnapshotMagic));
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        for (const auto& [nnid, entry] : entries_) {
+            int64_t id = nnid;
+            out.write(reinterpret_cast<const char*>(&id), sizeof(id));
+            out.write(reinterpret_cast<const char*>(&entry.notice.hash), sizeof(entry.notice.hash));
+            writeString(out, entry.notice.creatTime);
+            writeString(out, entry.notice.title);
+            writeString(out, entry.notice.programaName);
+            writeString(out, entry.notice.synopsis);
+            writeString(out, entry.notice.link);
+        }
+        if (!out.flush()) {
+            throw std::runtime_error("无法写入快照: " + tmpPath);
+        }
+    }
+    std::filesystem::rename(tmpPath, path);
+}
@@ -0,0 +1,299 @@
+//
+// Created by athbe on 2026/10/18.
+//
+#include "Outbox.h"
+#include <nlohmann/json.hpp>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kCompactThreshold = 64;  // 过期记录达到该数量时重写日志
+
+// 将完整缓冲区写入文件描述符
+void writeAll(int fd, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("写入发件箱失败: " + std::string(std::strerror(errno)));
+        }
+        written += static_cast<size_t>(n);
+    }
+}
+
+// fsync所在目录，保证rename落盘
+void syncDirectory(const std::filesystem::path& dir) {
+    int dfd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dfd >= 0) {
+        ::fsync(dfd);
+        ::close(dfd);
+    }
+}
+
+nlohmann::json entryToJson(const Outbox::Entry& entry) {
+    return {
+        {"op", "put"},
+        {"id", entry.id},
+        {"channel", entry.channel},
+        {"recipient", entry.recipient},
+        {"subject", entry.subject},
+        {"body", entry.body},
+        {"brief", entry.brief},
+        {"nnids", entry.nnids}
+    };
+}
+
+} // namespace
+
+Outbox::Outbox(const std::string& path) : path_(path) {
+    std::filesystem::path p(path_);
+    if (p.has_parent_path()) {
+        std::filesystem::create_directories(p.parent_path());
+    }
+
+    // 同一发件箱只允许一个进程使用：各自重放、分配序号和重写日志会导致重复投递或记录丢失。
+    // 日志重写时会被替换，所以锁加在单独的文件上，持有到发件箱关闭
+    std::string lockPath = path_ + ".lock";
+    lockFd_ = ::open(lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (lockFd_ < 0) {
+        throw std::runtime_error("无法打开发件箱锁: " + lockPath + ": " + std::strerror(errno));
+    }
+    if (::flock(lockFd_, LOCK_EX | LOCK_NB) != 0) {
+        int err = errno;
+        ::close(lockFd_);
+        if (err == EWOULDBLOCK) {
+            throw std::runtime_error("发件箱正被其他进程使用: " + path_);
+        }
+        throw std::runtime_error("无法锁定发件箱: " + path_ + ": " + std::strerror(err));
+    }
+
+    try {
+        replay();
+        if (tornTail_ || obsoleteRecords_ >= kCompactThreshold) {
+            compact();
+        } else {
+            std::error_code ec;
+            auto size = std::filesystem::file_size(path_, ec);
+            writtenLsn_ = durableLsn_ = ec ? 0 : size;
+        }
+
+        fd_ = ::open(path_.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            throw std::runtime_error("无法打开发件箱: " + path_ + ": " + std::strerror(errno));
+        }
+    } catch (...) {
+        ::close(lockFd_);
+        throw;
+    }
+}
+
+Outbox::~Outbox() {
+    if (fd_ >= 0) {
+        try {
+            commit();
+        } catch (...) {
+            // 析构时无法上报错误，未落盘的记录在下次启动时按未完成处理
+        }
+        ::close(fd_);
+    }
+    // 关闭后释放flock
+    ::close(lockFd_);
+}
+
+std::string Outbox::makeKey(long long nnid, const std::string& channel, const std::string& recipient) {
+    return channel + '\x1f' + recipient + '\x1f' + std::to_string(nnid);
+}
+
+void Outbox::replay() {
+    std::ifstream in(path_);
+    if (!in) {
+        return;
+    }
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+
+        nlohmann::json record;
+        try {
+            record = nlohmann::json::parse(line);
+        } catch (const nlohmann::json::parse_error&) {
+            // 进程崩溃时最后一行可能写了一半，之后的内容不可信
+            tornTail_ = true;
+            break;
+        }
+
+        std::string op = record.value("op", "");
+        if (op == "put") {
+            Entry entry;
+            entry.id = record.value("id", uint64_t{0});
+            entry.channel = record.value("channel", "");
+            entry.recipient = record.value("recipient", "");
+            entry.subject = record.value("subject", "");
+            entry.body = record.value("body", "");
+            entry.brief = record.value("brief", "");
+            entry.nnids = record.value("nnids", std::vector<long long>{});
+            nextId_ = std::max(nextId_, entry.id + 1);
+            pending_[entry.id] = std::move(entry);
+        } else if (op == "done") {
+            auto it = pending_.find(record.value("id", uint64_t{0}));
+            if (it != pending_.end()) {
+                for (long long nnid : it->second.nnids) {
+                    delivered_.insert(makeKey(nnid, it->second.channel, it->second.recipient));
+                }
+                pending_.erase(it);
+                obsoleteRecords_ += 2;
+            }
+        } else if (op == "delivered") {
+            std::string channel = record.value("channel", "");
+            std::string recipient = record.value("recipient", "");
+            for (long long nnid : record.value("nnids", std::vector<long long>{})) {
+                delivered_.insert(makeKey(nnid, channel, recipient));
+            }
+        }
+    }
+
+    for (const auto& [id, entry] : pending_) {
+        for (long long nnid : entry.nnids) {
+            queued_.insert(makeKey(nnid, entry.channel, entry.recipient));
+        }
+    }
+}
+
+void Outbox::compact() {
+    // 按 (渠道, 收件人) 归并已投递的通知ID
+    std::map<std::pair<std::string, std::string>, std::vector<long long>> grouped;
+    for (const auto& key : delivered_) {
+        size_t first = key.find('\x1f');
+        size_t second = key.find('\x1f', first + 1);
+        grouped[{key.substr(0, first), key.substr(first + 1, second - first - 1)}]
+            .push_back(std::stoll(key.substr(second + 1)));
+    }
+
+    std::string content;
+    for (auto& [target, nnids] : grouped) {
+        std::sort(nnids.begin(), nnids.end());
+        nlohmann::json record = {
+            {"op", "delivered"},
+            {"channel", target.first},
+            {"recipient", target.second},
+            {"nnids", nnids}
+        };
+        content += record.dump() + "\n";
+    }
+    for (const auto& [id, entry] : pending_) {
+        content += entryToJson(entry).dump() + "\n";
+    }
+
+    // 写临时文件后原子替换
+    std::string tmpPath = path_ + ".tmp";
+    int tmp = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (tmp < 0) {
+        throw std::runtime_error("无法创建发件箱临时文件: " + tmpPath + ": " + std::strerror(errno));
+    }
+    try {
+        writeAll(tmp, content);
+    } catch (...) {
+        ::close(tmp);
+        throw;
+    }
+    ::fsync(tmp);
+    ::close(tmp);
+
+    if (::rename(tmpPath.c_str(), path_.c_str()) != 0) {
+        throw std::runtime_error("无法替换发件箱: " + path_ + ": " + std::strerror(errno));
+    }
+    syncDirectory(std::filesystem::path(path_).parent_path());
+
+    writtenLsn_ = durableLsn_ = content.size();
+}
+
+void Outbox::appendLine(const std::string& line) {
+    // 调用方持有 mutex_
+    writeAll(fd_, line + "\n");
+    writtenLsn_ += line.size() + 1;
+}
+
+bool Outbox::contains(long long nnid, const std::string& channel, const std::string& recipient) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string key = makeKey(nnid, channel, recipient);
+    return delivered_.count(key) > 0 || queued_.count(key) > 0;
+}
+
+uint64_t Outbox::enqueue(Entry entry) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entry.id = nextId_++;
+    appendLine(entryToJson(entry).dump());
+
+    for (long long nnid : entry.nnids) {
+        queued_.insert(makeKey(nnid, entry.channel, entry.recipient));
+    }
+    uint64_t id = entry.id;
+    pending_[id] = std::move(entry);
+    return id;
+}
+
+void Outbox::markDone(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pending_.find(id);
+    if (it == pending_.end()) {
+        return;
+    }
+
+    nlohmann::json record = {{"op", "done"}, {"id", id}};
+    appendLine(record.dump());
+
+    for (long long nnid : it->second.nnids) {
+        std::string key = makeKey(nnid, it->second.channel, it->second.recipient);
+        queued_.erase(key);
+        delivered_.insert(std::move(key));
+    }
+    pending_.erase(it);
+}
+
+void Outbox::commit() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t target = writtenLsn_;
+
+    while (durableLsn_ < target) {
+        if (syncing_) {
+            // 其他线程正在fsync，等待其批次完成后再检查
+            synced_.wait(lock);
+            continue;
+        }
+
+        // 成为本批次的提交者，一次fsync覆盖当前已写入的所有记录
+        syncing_ = true;
+        uint64_t batchEnd = writtenLsn_;
+        lock.unlock();
+        int rc = ::fdatasync(fd_);
+        int err = errno;
+        lock.lock();
+        syncing_ = false;
+        synced_.notify_all();
+
+        if (rc != 0) {
+            throw std::runtime_error("发件箱fsync失败: " + std::string(std::strerror(err)));
+        }
+        durableLsn_ = std::max(durableLsn_, batchEnd);
+    }
+}
+
+std::vector<Outbox::Entry> Outbox::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Entry> entries;
+    entries.reserve(pending_.size());
+    for (const auto& [id, entry] : pending_) {
+        entries.push_back(entry);
+    }
+    return entries;
+}
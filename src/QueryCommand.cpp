@@ -0,0 +1,199 @@
+//
+// Created by athbe on 2026/10/18.
+//
+#include "QueryCommand.h"
+#include "NoticeArchive.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+
+namespace {
+
+// 以逗号分隔的参数
+std::vector<std::string> splitList(const std::string& text) {
+    std::vector<std::string> parts;
+    std::istringstream ss(text);
+    std::string part;
+    while (std::getline(ss, part, ',')) {
+        if (!part.empty()) parts.push_back(part);
+    }
+    return parts;
+}
+
+void lowerInto(std::string& out, std::string_view text) {
+    out.assign(text.begin(), text.end());
+    std::transform(out.begin(), out.end(), out.begin(),
+                   [](unsigned char c){ return std::tolower(c); });
+}
+
+// 每个栏目的发布统计
+struct ProgramaStats {
+    size_t count = 0;
+    long long first = std::numeric_limits<long long>::max();
+    long long last = std::numeric_limits<long long>::min();
+};
+
+} // namespace
+
+long long QueryCommand::parseDate(const std::string& date, bool end_of_day) {
+    std::tm tm = {};
+    std::istringstream ss(date);
+    ss >> std::get_time(&tm, "%Y-%m-%d");
+    if (ss.fail()) {
+        throw std::runtime_error("无法解析日期: " + date);
+    }
+    // 输入为北京时间 (UTC+8)
+    long long epoch = static_cast<long long>(timegm(&tm)) - 8 * 3600;
+    return end_of_day ? epoch + 86400 - 1 : epoch;
+}
+
+std::string QueryCommand::formatTime(long long epoch) {
+    time_t t = static_cast<time_t>(epoch + 8 * 3600);
+    std::tm tm = {};
+    gmtime_r(&t, &tm);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M", &tm);
+    return buffer;
+}
+
+void QueryCommand::printUsage() {
+    std::fputs(
+        "用法: lqNotice query [选项]\n"
+        "  --archive 目录         归档目录（默认 state/archive）\n"
+        "  --from 日期            起始日期，北京时间，格式 2025-01-01\n"
+        "  --to 日期              结束日期（含当天）\n"
+        "  --keywords a,b         必须全部包含的关键词\n"
+        "  --fields title,synopsis 参与关键词匹配的字段（默认 title）\n"
+        "  --programa 栏目        只统计指定栏目\n"
+        "  --stats                输出各栏目的发布频率而不是逐条列出\n",
+        stdout);
+}
+
+int QueryCommand::run(const std::vector<std::string>& args) {
+    std::string archiveDir = "state/archive";
+    long long from = std::numeric_limits<long long>::min();
+    long long to = std::numeric_limits<long long>::max();
+    std::vector<std::string> keywords;
+    std::vector<std::string> fields = {"title"};
+    std::string programa;
+    bool stats = false;
+
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        auto value = [&]() -> const std::string& {
+            if (i + 1 >= args.size()) {
+                throw std::runtime_error("参数缺少取值: " + arg);
+            }
+            return args[++i];
+        };
+
+        if (arg == "--archive") {
+            archiveDir = value();
+        } else if (arg == "--from") {
+            from = parseDate(value(), false);
+        } else if (arg == "--to") {
+            to = parseDate(value(), true);
+        } else if (arg == "--keywords") {
+            keywords = splitList(value());
+        } else if (arg == "--fields") {
+            fields = splitList(value());
+        } else if (arg == "--programa") {
+            programa = value();
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return 0;
+        } else {
+            printUsage();
+            throw std::runtime_error("未知参数: " + arg);
+        }
+    }
+
+    // 关键词只转换一次小写，匹配时复用缓冲区
+    std::vector<std::string> lowerKeywords(keywords.size());
+    for (size_t i = 0; i < keywords.size(); ++i) {
+        lowerInto(lowerKeywords[i], keywords[i]);
+    }
+    bool useTitle = std::find(fields.begin(), fields.end(), "title") != fields.end();
+    bool useSynopsis = std::find(fields.begin(), fields.end(), "synopsis") != fields.end();
+    bool useProgramaField = std::find(fields.begin(), fields.end(), "programa") != fields.end();
+
+    std::string text;
+    std::string lowered;
+    auto matches = [&](const NoticeArchive::Row& row) {
+        if (!programa.empty() && row.programa != programa) {
+            return false;
+        }
+        if (lowerKeywords.empty()) {
+            return true;
+        }
+
+        text.clear();
+        if (useTitle) { text.append(row.title); text += '\n'; }
+        if (useSynopsis) { text.append(row.synopsis); text += '\n'; }
+        if (useProgramaField) { text.append(row.programa); text += '\n'; }
+        lowerInto(lowered, text);
+
+        for (const auto& keyword : lowerKeywords) {
+            if (lowered.find(keyword) == std::string::npos) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    NoticeArchive::Reader reader(archiveDir);
+
+    size_t matched = 0;
+    std::unordered_set<long long> distinct;
+    std::map<std::string, ProgramaStats> byPrograma;
+
+    reader.scan(from, to, [&](const NoticeArchive::Row& row) {
+        if (!matches(row)) return;
+        matched++;
+
+        if (stats) {
+            // 同一通知的多个版本只计一次
+            if (!distinct.insert(row.nnid).second) return;
+            auto& entry = byPrograma[std::string(row.programa)];
+            entry.count++;
+            entry.first = std::min(entry.first, static_cast<long long>(row.epoch));
+            entry.last = std::max(entry.last, static_cast<long long>(row.epoch));
+            return;
+        }
+
+        distinct.insert(row.nnid);
+        std::printf("%s  [%.*s] %.*s (nnid %lld)\n",
+                    formatTime(row.epoch).c_str(),
+                    static_cast<int>(row.programa.size()), row.programa.data(),
+                    static_cast<int>(row.title.size()), row.title.data(),
+                    row.nnid);
+    });
+
+    if (stats) {
+        std::printf("%-24s %8s  %-16s  %-16s  %s\n", "栏目", "通知数", "首次", "最近", "平均间隔(天)");
+        for (const auto& [name, entry] : byPrograma) {
+            double interval = entry.count > 1
+                ? static_cast<double>(entry.last - entry.first) / 86400.0 / static_cast<double>(entry.count - 1)
+                : 0.0;
+            std::printf("%-24s %8zu  %-16s  %-16s  %.1f\n", name.c_str(), entry.count,
+                        formatTime(entry.first).c_str(), formatTime(entry.last).c_str(), interval);
+        }
+    }
+
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+    std::printf("共 %zu 行命中（%zu 条不同通知），归档共 %zu 行，用时 %.2f ms\n",
+                matched, distinct.size(), reader.rows(), elapsed.count());
+    return 0;
+}
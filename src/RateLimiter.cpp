@@ -0,0 +1,97 @@
+//
+// Created by athbe on 2026/10/18.
+//
+#include "RateLimiter.h"
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Bucket {
+    std::mutex mutex;
+    RateLimiter::Limit limit;
+    double tokens = 0;
+    Clock::time_point updated = Clock::now();
+
+    // 按流逝时间补充令牌（调用方持有 mutex）
+    void refill(Clock::time_point now) {
+        double elapsed = std::chrono::duration<double>(now - updated).count();
+        tokens = std::min(limit.burst, tokens + elapsed * limit.rate);
+        updated = now;
+    }
+};
+
+std::mutex gRegistryMutex;
+std::unordered_map<std::string, std::unique_ptr<Bucket>> gBuckets;
+
+// 查找已配置的桶，未配置时返回nullptr（不限流）
+Bucket* find(const std::string& key) {
+    std::lock_guard<std::mutex> lock(gRegistryMutex);
+    auto it = gBuckets.find(key);
+    return it == gBuckets.end() ? nullptr : it->second.get();
+}
+
+} // namespace
+
+void RateLimiter::configure(const std::string& key, const Limit& limit) {
+    std::lock_guard<std::mutex> lock(gRegistryMutex);
+    if (limit.rate <= 0) {
+        gBuckets.erase(key);
+        return;
+    }
+
+    auto& bucket = gBuckets[key];
+    if (!bucket) {
+        bucket = std::make_unique<Bucket>();
+    }
+    std::lock_guard<std::mutex> bucketLock(bucket->mutex);
+    bucket->limit.rate = limit.rate;
+    bucket->limit.burst = std::max(1.0, limit.burst);
+    bucket->tokens = bucket->limit.burst;
+    bucket->updated = Clock::now();
+}
+
+std::chrono::milliseconds RateLimiter::acquire(const std::string& key) {
+    Bucket* bucket = find(key);
+    if (!bucket) {
+        return std::chrono::milliseconds(0);
+    }
+
+    std::chrono::duration<double> wait(0);
+    {
+        std::lock_guard<std::mutex> lock(bucket->mutex);
+        bucket->refill(Clock::now());
+
+        // 先扣除令牌（可能变为负数，表示已预留的未来令牌）
+        bucket->tokens -= 1;
+        if (bucket->tokens < 0) {
+            wait = std::chrono::duration<double>(-bucket->tokens / bucket->limit.rate);
+        }
+    }
+
+    auto waitMs = std::chrono::ceil<std::chrono::milliseconds>(wait);
+    if (waitMs.count() > 0) {
+        std::this_thread::sleep_for(waitMs);
+    }
+    return waitMs;
+}
+
+bool RateLimiter::tryAcquire(const std::string& key) {
+    Bucket* bucket = find(key);
+    if (!bucket) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(bucket->mutex);
+    bucket->refill(Clock::now());
+    if (bucket->tokens < 1) {
+        return false;
+    }
+    bucket->tokens -= 1;
+    return true;
+}
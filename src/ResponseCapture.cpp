@@ -0,0 +1,141 @@
+//
+// Created by athbe on 2026/10/18.
+//
+#include "ResponseCapture.h"
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+// 文件格式：魔数，之后每条记录为 URL、获取时间、耗时、状态码、响应头、响应内容
+// 字符串带32位长度前缀，整数为本机字节序
+constexpr char kCaptureMagic[4] = {'L', 'Q', 'C', '1'};
+
+template <typename T>
+void writeValue(std::ostream& out, T value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void writeString(std::ostream& out, const std::string& text) {
+    writeValue(out, static_cast<uint32_t>(text.size()));
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+// 从内存缓冲区顺序读取，越界时返回false
+class Cursor {
+public:
+    Cursor(const std::string& data, size_t pos) : data_(data), pos_(pos) {}
+
+    template <typename T>
+    bool read(T& value) {
+        if (data_.size() - pos_ < sizeof(T)) return false;
+        std::memcpy(&value, data_.data() + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return true;
+    }
+
+    bool read(std::string& text) {
+        uint32_t length = 0;
+        if (!read(length) || data_.size() - pos_ < length) return false;
+        text.assign(data_, pos_, length);
+        pos_ += length;
+        return true;
+    }
+
+    bool atEnd() const { return pos_ >= data_.size(); }
+    size_t position() const { return pos_; }
+
+private:
+    const std::string& data_;
+    size_t pos_;
+};
+
+// 读取一条完整记录，数据不完整时返回false
+bool readRecord(Cursor& cursor, ResponseCapture::Record& record) {
+    int32_t status = 0;
+    if (!cursor.read(record.url) || !cursor.read(record.fetchedAt) || !cursor.read(record.durationUs) ||
+        !cursor.read(status) || !cursor.read(record.headers) || !cursor.read(record.body)) {
+        return false;
+    }
+    record.status = status;
+    return true;
+}
+
+} // namespace
+
+ResponseCapture::Writer::Writer(const std::string& path) {
+    std::error_code ec;
+    auto parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) {
+        std::filesystem::create_directories(parent, ec);
+    }
+
+    // 已有内容时必须是录制文件，避免追加到其他文件末尾
+    bool empty = !std::filesystem::exists(path, ec) || std::filesystem::file_size(path, ec) == 0;
+    if (!empty) {
+        std::string data;
+        {
+            std::ifstream in(path, std::ios::binary);
+            data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        if (data.size() < sizeof(kCaptureMagic) ||
+            std::memcmp(data.data(), kCaptureMagic, sizeof(kCaptureMagic)) != 0) {
+            throw std::runtime_error("不是录制文件: " + path);
+        }
+
+        // 上次录制中断留下的不完整记录截掉，否则追加的记录都无法读出
+        Cursor cursor(data, sizeof(kCaptureMagic));
+        size_t complete = cursor.position();
+        Record record;
+        while (!cursor.atEnd() && readRecord(cursor, record)) {
+            complete = cursor.position();
+        }
+        if (complete < data.size()) {
+            std::filesystem::resize_file(path, complete);
+        }
+    }
+
+    out_.open(path, std::ios::binary | std::ios::app);
+    if (!out_) {
+        throw std::runtime_error("无法打开录制文件: " + path);
+    }
+    if (empty) {
+        out_.write(kCaptureMagic, sizeof(kCaptureMagic));
+        out_.flush();
+    }
+}
+
+void ResponseCapture::Writer::append(const Record& record) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    writeString(out_, record.url);
+    writeValue(out_, record.fetchedAt);
+    writeValue(out_, record.durationUs);
+    writeValue(out_, static_cast<int32_t>(record.status));
+    writeString(out_, record.headers);
+    writeString(out_, record.body);
+    out_.flush();
+}
+
+std::vector<ResponseCapture::Record> ResponseCapture::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("无法打开录制文件: " + path);
+    }
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.size() < sizeof(kCaptureMagic) || std::memcmp(data.data(), kCaptureMagic, sizeof(kCaptureMagic)) != 0) {
+        throw std::runtime_error("不是录制文件: " + path);
+    }
+
+    std::vector<Record> records;
+    Cursor cursor(data, sizeof(kCaptureMagic));
+    while (!cursor.atEnd()) {
+        Record record;
+        if (!readRecord(cursor, record)) {
+            break;
+        }
+        records.push_back(std::move(record));
+    }
+    return records;
+}
@@ -0,0 +1,260 @@
+//
+// Created by athbe on 2026/10/18.
+//
+#include "ShardCoordinator.h"
+#include "Logger.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr int kVirtualNodes = 64;  // 每个实例在哈希环上的虚拟节点数
+
+// 读取整个文件描述符的内容
+std::string readAll(int fd) {
+    std::string content;
+    char buffer[512];
+    off_t offset = 0;
+    while (true) {
+        ssize_t n = ::pread(fd, buffer, sizeof(buffer), offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("读取租约失败: " + std::string(std::strerror(errno)));
+        }
+        if (n == 0) break;
+        content.append(buffer, static_cast<size_t>(n));
+        offset += n;
+    }
+    return content;
+}
+
+// 覆盖写入租约内容并落盘
+void overwrite(int fd, const std::string& content) {
+    if (::ftruncate(fd, 0) != 0 ||
+        ::pwrite(fd, content.data(), content.size(), 0) != static_cast<ssize_t>(content.size()) ||
+        ::fdatasync(fd) != 0) {
+        throw std::runtime_error("写入租约失败: " + std::string(std::strerror(errno)));
+    }
+}
+
+std::string defaultInstanceId() {
+    char host[256] = {};
+    if (::gethostname(host, sizeof(host) - 1) != 0) {
+        std::strcpy(host, "localhost");
+    }
+    return std::string(host) + "-" + std::to_string(::getpid());
+}
+
+} // namespace
+
+ShardCoordinator::ShardCoordinator(Options options) : options_(std::move(options)) {
+    if (options_.instance_id.empty()) {
+        options_.instance_id = defaultInstanceId();
+    }
+    if (options_.lease.count() <= 0) {
+        throw std::runtime_error("租约有效期必须大于0");
+    }
+    std::filesystem::create_directories(options_.dir + "/members");
+    std::filesystem::create_directories(options_.dir + "/leases");
+}
+
+int64_t ShardCoordinator::nowMs() {
+    // 共享存储上的多台主机之间只能比较墙上时间
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+uint64_t ShardCoordinator::hash(const std::string& text) {
+    // 64位FNV-1a，再做一次混合使相邻键在环上分散
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : text) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+void ShardCoordinator::heartbeat() {
+    const int64_t now = nowMs();
+    const int64_t leaseMs = std::chrono::duration_cast<std::chrono::milliseconds>(options_.lease).count();
+
+    // 写临时文件后原子替换，其他实例不会读到半个心跳
+    std::string path = options_.dir + "/members/" + options_.instance_id;
+    {
+        std::ofstream out(path + ".tmp", std::ios::trunc);
+        out << nlohmann::json{
+            {"id", options_.instance_id},
+            {"pid", ::getpid()},
+            {"expires", now + leaseMs}
+        }.dump();
+        if (!out.flush()) {
+            throw std::runtime_error("无法写入心跳: " + path);
+        }
+    }
+    std::filesystem::rename(path + ".tmp", path);
+
+    std::set<std::string> members;
+    for (const auto& file : std::filesystem::directory_iterator(options_.dir + "/members")) {
+        if (file.path().extension() == ".tmp") continue;
+
+        nlohmann::json record;
+        try {
+            std::ifstream in(file.path());
+            in >> record;
+        } catch (const std::exception&) {
+            continue;
+        }
+        int64_t expires = record.value("expires", int64_t{0});
+        if (expires > now) {
+            members.insert(record.value("id", file.path().filename().string()));
+        } else if (now - expires > 10 * leaseMs) {
+            // 早已退出的实例，清理其心跳文件
+            std::error_code ec;
+            std::filesystem::remove(file.path(), ec);
+        }
+    }
+    members.insert(options_.instance_id);
+
+    if (members != members_) {
+        auto line = Logger::info();
+        line << "[集群] 存活实例 " << members.size() << " 个:";
+        for (const auto& member : members) {
+            line << " " << member;
+        }
+    }
+    members_ = std::move(members);
+
+    ring_.clear();
+    ring_.reserve(members_.size() * kVirtualNodes);
+    for (const auto& member : members_) {
+        for (int i = 0; i < kVirtualNodes; ++i) {
+            ring_.emplace_back(hash(member + "#" + std::to_string(i)), member);
+        }
+    }
+    std::sort(ring_.begin(), ring_.end());
+}
+
+std::string ShardCoordinator::ownerOf(const std::string& key) const {
+    if (ring_.empty()) {
+        return options_.instance_id;
+    }
+    auto it = std::lower_bound(ring_.begin(), ring_.end(), std::make_pair(hash(key), std::string()));
+    if (it == ring_.end()) {
+        it = ring_.begin();
+    }
+    return it->second;
+}
+
+bool ShardCoordinator::acquire(const std::string& key) {
+    return updateLease(key, Mode::Acquire);
+}
+
+bool ShardCoordinator::renew(const std::string& key) {
+    if (held_.count(key) == 0) {
+        return false;
+    }
+    return updateLease(key, Mode::Renew);
+}
+
+void ShardCoordinator::leave() {
+    std::vector<std::string> keys;
+    for (const auto& [key, epoch] : held_) {
+        keys.push_back(key);
+    }
+    for (const auto& key : keys) {
+        try {
+            updateLease(key, Mode::Release);
+        } catch (const std::exception& e) {
+            Logger::warn() << "[集群] 释放租约失败: " << key << ": " << e.what();
+        }
+    }
+    std::error_code ec;
+    std::filesystem::remove(options_.dir + "/members/" + options_.instance_id, ec);
+}
+
+bool ShardCoordinator::updateLease(const std::string& key, Mode mode) {
+    std::string path = options_.dir + "/leases/" + key + ".lease";
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("无法打开租约: " + path + ": " + std::strerror(errno));
+    }
+
+    bool holding = false;
+    uint64_t heldEpoch = 0;
+    try {
+        while (::flock(fd, LOCK_EX) != 0) {
+            if (errno != EINTR) {
+                throw std::runtime_error("无法锁定租约: " + path + ": " + std::strerror(errno));
+            }
+        }
+
+        std::string owner;
+        int64_t expires = 0;
+        uint64_t epoch = 0;
+        std::string content = readAll(fd);
+        if (!content.empty()) {
+            try {
+                auto record = nlohmann::json::parse(content);
+                owner = record.value("owner", "");
+                expires = record.value("expires", int64_t{0});
+                epoch = record.value("epoch", uint64_t{0});
+            } catch (const nlohmann::json::parse_error&) {
+                // 损坏的租约视为空闲
+            }
+        }
+
+        const int64_t now = nowMs();
+        // 只有epoch与获取时一致才算本进程持有；同ID的旧进程留下的未过期租约视为空闲，接管时递增epoch
+        auto held = held_.find(key);
+        const bool sameOwner = owner == options_.instance_id && expires > now;
+        const bool mine = sameOwner && held != held_.end() && held->second == epoch;
+        const bool vacant = owner.empty() || expires <= now || (sameOwner && held == held_.end());
+        const bool preferred = ownerOf(key) == options_.instance_id;
+        const int64_t leaseMs = std::chrono::duration_cast<std::chrono::milliseconds>(options_.lease).count();
+
+        auto write = [&](const std::string& newOwner, int64_t newExpires, uint64_t newEpoch) {
+            overwrite(fd, nlohmann::json{
+                {"owner", newOwner},
+                {"expires", newExpires},
+                {"epoch", newEpoch}
+            }.dump());
+        };
+
+        if (mine && (mode == Mode::Release || (mode == Mode::Acquire && !preferred))) {
+            // 主动释放：正常退出或哈希环上已归属其他实例
+            write("", 0, epoch);
+        } else if (mine) {
+            write(options_.instance_id, now + leaseMs, epoch);
+            holding = true;
+            heldEpoch = epoch;
+        } else if (mode == Mode::Acquire && vacant && preferred) {
+            // 每次易主递增epoch，原持有者续期时据此发现已被接管
+            write(options_.instance_id, now + leaseMs, epoch + 1);
+            holding = true;
+            heldEpoch = epoch + 1;
+        }
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    // 关闭文件描述符同时释放flock
+    ::close(fd);
+
+    if (holding) {
+        held_[key] = heldEpoch;
+    } else {
+        held_.erase(key);
+    }
+    return holding;
+}
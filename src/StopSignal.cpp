@@ -0,0 +1,95 @@
+//
+// Created by athbe on 2026/10/18.
+//
+#include "StopSignal.h"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr int kSignals[] = {SIGTERM, SIGINT};
+
+std::atomic<int> gWriteFd{-1};
+struct sigaction gPrevious[std::size(kSignals)];
+
+// 只做异步信号安全的操作：把信号编号写入管道
+void onSignal(int signo) {
+    int saved = errno;
+    int fd = gWriteFd.load(std::memory_order_relaxed);
+    if (fd >= 0) {
+        char byte = static_cast<char>(signo);
+        (void)::write(fd, &byte, 1);
+    }
+    errno = saved;
+}
+
+void setHandler(void (*handler)(int)) {
+    struct sigaction action = {};
+    action.sa_handler = handler;
+    sigemptyset(&action.sa_mask);
+    for (int signo : kSignals) {
+        ::sigaction(signo, &action, nullptr);
+    }
+}
+
+} // namespace
+
+StopSignal::StopSignal(std::function<void(int)> onSignal) : onSignal_(std::move(onSignal)) {
+    if (::pipe2(pipe_, O_CLOEXEC) != 0) {
+        throw std::runtime_error("无法创建信号管道: " + std::string(std::strerror(errno)));
+    }
+    gWriteFd.store(pipe_[1], std::memory_order_relaxed);
+
+    struct sigaction action = {};
+    action.sa_handler = ::onSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    for (size_t i = 0; i < std::size(kSignals); ++i) {
+        ::sigaction(kSignals[i], &action, &gPrevious[i]);
+    }
+
+    thread_ = std::thread(&StopSignal::wait, this);
+}
+
+StopSignal::~StopSignal() {
+    for (size_t i = 0; i < std::size(kSignals); ++i) {
+        ::sigaction(kSignals[i], &gPrevious[i], nullptr);
+    }
+    gWriteFd.store(-1, std::memory_order_relaxed);
+
+    // 0 不是有效的信号编号，用于通知等待线程退出
+    char byte = 0;
+    (void)::write(pipe_[1], &byte, 1);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    ::close(pipe_[0]);
+    ::close(pipe_[1]);
+}
+
+void StopSignal::wait() {
+    bool received = false;
+    while (true) {
+        char byte = 0;
+        ssize_t n = ::read(pipe_[0], &byte, 1);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0 || byte == 0) {
+            return;
+        }
+        if (!received) {
+            received = true;
+            // 再次收到信号时直接终止，避免卡在无法中断的操作上
+            setHandler(SIG_DFL);
+            onSignal_(byte);
+        }
+    }
+}
@@ -0,0 +1,178 @@
+//
+// Created by athbe on 2026/10/18.
+//
+#include "Tracer.h"
+#include "Logger.h"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <filesystem>
+#include <mutex>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kMaxEvents = 200000;  // 两次flush之间最多缓存的事件数，超出后丢弃最早的事件
+
+std::atomic<bool> gEnabled{false};
+std::mutex gMutex;
+std::string gPath;
+std::deque<nlohmann::json> gEvents;  // 尚未写入文件的事件
+
+// trace文件：JSON数组格式，每次flush只追加新事件（查看器允许省略末尾的 "]"）
+std::mutex gFileMutex;
+std::ofstream gOut;
+
+// 每个线程分配一个较小的编号，便于在查看器中区分
+int threadLaneBase() {
+    static std::atomic<int> nextThread{1};
+    thread_local int base = nextThread.fetch_add(1) * 10;
+    return base;
+}
+
+} // namespace
+
+Tracer::Span::Span(const char* name, const char* category)
+    : name_(name), category_(category), active_(Tracer::enabled()) {
+    if (active_) {
+        startUs_ = Tracer::nowUs();
+    }
+}
+
+Tracer::Span::~Span() {
+    if (active_) {
+        Tracer::addSpan(name_, category_, startUs_, Tracer::nowUs() - startUs_, std::move(args_));
+    }
+}
+
+void Tracer::Span::arg(const std::string& key, nlohmann::json value) {
+    if (active_) {
+        args_[key] = std::move(value);
+    }
+}
+
+void Tracer::enable(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> fileLock(gFileMutex);
+        if (gOut.is_open()) {
+            gOut.close();
+        }
+    }
+    std::lock_guard<std::mutex> lock(gMutex);
+    gPath = path;
+    gEnabled.store(!path.empty(), std::memory_order_release);
+}
+
+bool Tracer::enabled() {
+    return gEnabled.load(std::memory_order_relaxed);
+}
+
+int64_t Tracer::nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::addSpan(const std::string& name, const char* category,
+                     int64_t startUs, int64_t durationUs,
+                     nlohmann::json args, int lane) {
+    if (!enabled()) {
+        return;
+    }
+
+    nlohmann::json event = {
+        {"name", name},
+        {"cat", category},
+        {"ph", "X"},
+        {"ts", startUs},
+        {"dur", std::max<int64_t>(durationUs, 0)},
+        {"pid", static_cast<int>(::getpid())},
+        {"tid", threadLaneBase() + lane}
+    };
+    if (!args.is_null()) {
+        event["args"] = std::move(args);
+    }
+
+    std::lock_guard<std::mutex> lock(gMutex);
+    gEvents.push_back(std::move(event));
+    if (gEvents.size() > kMaxEvents) {
+        gEvents.pop_front();
+    }
+}
+
+void Tracer::recordCurlTimings(CURL* curl, int64_t startUs, int lane) {
+    if (!enabled() || !curl) {
+        return;
+    }
+
+    // 各时间点均为从请求开始累计的微秒数
+    curl_off_t namelookup = 0, connect = 0, appconnect = 0, pretransfer = 0, starttransfer = 0, total = 0;
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &namelookup);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &appconnect);
+    curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME_T, &pretransfer);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &starttransfer);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+
+    char* url = nullptr;
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url);
+    nlohmann::json args = {{"url", url ? url : ""}};
+
+    addSpan("request", "net", startUs, total, args, lane);
+    addSpan("dns", "net", startUs, namelookup, nullptr, lane);
+    addSpan("connect", "net", startUs + namelookup, connect - namelookup, nullptr, lane);
+    int64_t connected = connect;
+    if (appconnect > 0) {
+        addSpan("tls", "net", startUs + connect, appconnect - connect, nullptr, lane);
+        connected = appconnect;
+    }
+    if (starttransfer > 0) {
+        addSpan("wait", "net", startUs + std::max<int64_t>(connected, pretransfer),
+                starttransfer - std::max<int64_t>(connected, pretransfer), nullptr, lane);
+        addSpan("transfer", "net", startUs + starttransfer, total - starttransfer, nullptr, lane);
+    }
+}
+
+void Tracer::flush() {
+    if (!enabled()) {
+        return;
+    }
+
+    // 只在交换缓冲区时持有全局锁，序列化和写文件不阻塞记录区间的线程
+    std::deque<nlohmann::json> batch;
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(gMutex);
+        batch.swap(gEvents);
+        path = gPath;
+    }
+    if (batch.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> fileLock(gFileMutex);
+    if (!gOut.is_open()) {
+        std::error_code ec;
+        std::filesystem::path p(path);
+        if (p.has_parent_path()) {
+            std::filesystem::create_directories(p.parent_path(), ec);
+        }
+        gOut.open(path, std::ios::trunc);
+        if (!gOut) {
+            Logger::warn() << "无法写入trace文件: " << path;
+            return;
+        }
+        gOut << "[\n";
+    }
+
+    std::string text;
+    for (const auto& event : batch) {
+        text += event.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+        text += ",\n";
+    }
+    gOut << text;
+    gOut.flush();
+    if (!gOut) {
+        Logger::warn() << "无法写入trace文件: " << path;
+    }
+}
@@ -2,23 +2,102 @@
 // Created by athbe on 2025/6/17.
 //
 #include "AlertMonitor.h"
-#include <iostream>
+#include "JsonFetcher.h"
+#include "Logger.h"
+#include "QueryCommand.h"
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
-int main() {
+static void printUsage() {
+    std::fputs(
+        "用法: lqNotice [选项]\n"
+        "      lqNotice query [查询选项]\n"
+        "  --config 路径          配置文件（默认 config/settings.json）\n"
+        "  --once                 每个目标只检查一次后退出，退出码：\n"
+        "                         0 无提醒  1 错误  2 已发送提醒  3 获取失败  4 投递失败\n"
+        "                         5 上一次调用仍在运行（状态目录被占用）\n"
+        "  --instance-id ID       分片模式下的实例ID（覆盖配置中的 cluster.instance_id）\n"
+        "  --record 文件          把获取到的每个接口响应（含耗时和响应头）追加到录制文件\n"
+        "  --replay 文件          离线重放录制文件，测量解析、匹配和渲染的吞吐量后退出\n"
+        "  --iterations N         重放的轮数（默认1）\n",
+        stdout);
+}
+
+int main(int argc, char* argv[]) {
     try {
+        // 查询归档子命令
+        if (argc > 1 && std::strcmp(argv[1], "query") == 0) {
+            int status = QueryCommand::run(std::vector<std::string>(argv + 2, argv + argc));
+            Logger::shutdown();
+            return status;
+        }
+
+        std::string configPath = "config/settings.json";
+        bool once = false;
+        std::string instanceId;
+        std::string recordPath;
+        std::string replayPath;
+        int iterations = 1;
+        for (int i = 1; i < argc; ++i) {
+            if (std::strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+                configPath = argv[++i];
+            } else if (std::strcmp(argv[i], "--instance-id") == 0 && i + 1 < argc) {
+                instanceId = argv[++i];
+            } else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+                recordPath = argv[++i];
+            } else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+                replayPath = argv[++i];
+            } else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+                iterations = std::atoi(argv[++i]);
+                if (iterations < 1) {
+                    throw std::runtime_error("--iterations 必须大于0");
+                }
+            } else if (std::strcmp(argv[i], "--once") == 0) {
+                once = true;
+            } else if (std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0) {
+                printUsage();
+                return EXIT_SUCCESS;
+            } else {
+                printUsage();
+                throw std::runtime_error("未知参数: " + std::string(argv[i]));
+            }
+        }
+
         // 加载配置文件
-        AlertMonitor::Config config = AlertMonitor::loadConfig("config/settings.json");
+        AlertMonitor::Config config = AlertMonitor::loadConfig(configPath);
+        if (!instanceId.empty()) {
+            config.cluster.instance_id = instanceId;
+        }
+
+        // 离线重放，不访问网络
+        if (!replayPath.empty()) {
+            int status = AlertMonitor::replay(config, replayPath, iterations);
+            Logger::shutdown();
+            return status;
+        }
+
+        if (!recordPath.empty()) {
+            JsonFetcher::startRecording(recordPath);
+            Logger::info() << "录制接口响应到: " << recordPath;
+        }
+
+        // 单次检查
+        if (once) {
+            int status = AlertMonitor::runOnce(config);
+            Logger::shutdown();
+            return status;
+        }
 
         // 启动监控
-        AlertMonitor::run(config);
+        int status = AlertMonitor::run(config);
 
-        return EXIT_SUCCESS;
+        Logger::shutdown();
+        return status;
     } catch (const std::exception& e) {
-        std::cerr << "\n错误: " << e.what() << std::endl;
-        std::cerr << "程序异常终止" << std::endl;
+        Logger::error() << "错误: " << e.what();
+        Logger::error() << "程序异常终止";
+        Logger::shutdown();
         return EXIT_FAILURE;
     }
 }
-
-
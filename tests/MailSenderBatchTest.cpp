@@ -0,0 +1,172 @@
+//
+// Created by athbe on 2026/10/18.
+//
+// MailSender::sendBatch 的中继故障转移测试：
+// 两个中继各只允许一条连接，其中一个在问候阶段等待后返回421，另一个正常接收。
+// 发往故障中继的邮件必须转到正常中继重发，两封邮件都应投递成功。
+#include "MailSender.h"
+#include "Logger.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// 最小的SMTP服务器：每个连接一个线程，dead 为true时只返回421
+class FakeRelay {
+public:
+    explicit FakeRelay(bool dead) : dead_(dead) {
+        fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        if (::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd_, 16) != 0) {
+            std::perror("listen");
+            std::exit(2);
+        }
+        socklen_t length = sizeof(addr);
+        ::getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &length);
+        port_ = ntohs(addr.sin_port);
+        std::thread(&FakeRelay::serve, this).detach();
+    }
+
+    int port() const { return port_; }
+    int delivered() const { return delivered_.load(); }
+
+private:
+    void serve() {
+        while (true) {
+            int client = ::accept(fd_, nullptr, nullptr);
+            if (client < 0) return;
+            std::thread(&FakeRelay::session, this, client).detach();
+        }
+    }
+
+    static void reply(int fd, const char* text) {
+        (void)::send(fd, text, std::strlen(text), MSG_NOSIGNAL);
+    }
+
+    static bool readLine(int fd, std::string& buffer, std::string& line) {
+        while (true) {
+            auto pos = buffer.find("\r\n");
+            if (pos != std::string::npos) {
+                line = buffer.substr(0, pos);
+                buffer.erase(0, pos + 2);
+                return true;
+            }
+            char chunk[1024];
+            ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) return false;
+            buffer.append(chunk, static_cast<size_t>(n));
+        }
+    }
+
+    void session(int fd) {
+        if (dead_) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            reply(fd, "421 service not available\r\n");
+            ::close(fd);
+            return;
+        }
+
+        reply(fd, "220 fake\r\n");
+        std::string buffer;
+        std::string line;
+        bool data = false;
+        while (readLine(fd, buffer, line)) {
+            if (data) {
+                if (line == ".") {
+                    data = false;
+                    delivered_++;
+                    reply(fd, "250 ok\r\n");
+                }
+                continue;
+            }
+            std::string command = line.substr(0, 4);
+            if (command == "EHLO" || command == "HELO") {
+                reply(fd, "250-fake\r\n250 AUTH PLAIN\r\n");
+            } else if (command == "AUTH") {
+                // 不带初始响应时先要求客户端发送凭据
+                if (line.find(' ', 5) == std::string::npos) {
+                    reply(fd, "334 \r\n");
+                    if (!readLine(fd, buffer, line)) break;
+                }
+                reply(fd, "235 ok\r\n");
+            } else if (command == "DATA") {
+                data = true;
+                reply(fd, "354 go\r\n");
+            } else if (command == "QUIT") {
+                reply(fd, "221 bye\r\n");
+                break;
+            } else {
+                reply(fd, "250 ok\r\n");
+            }
+        }
+        ::close(fd);
+    }
+
+    bool dead_;
+    int fd_ = -1;
+    int port_ = 0;
+    std::atomic<int> delivered_{0};
+};
+
+MailSender::SmtpConfig relayConfig(int port, int weight) {
+    MailSender::SmtpConfig config;
+    config.server = "127.0.0.1";
+    config.port = port;
+    config.username = "sender@example.com";
+    config.password = "x";
+    config.useSsl = false;
+    config.weight = weight;
+    config.maxConnections = 1;
+    return config;
+}
+
+} // namespace
+
+int main() {
+    FakeRelay dead(true);
+    FakeRelay live(false);
+
+    // 故障中继权重更高，保证有邮件先分配到它
+    std::vector<MailSender::SmtpConfig> relays = {relayConfig(dead.port(), 5), relayConfig(live.port(), 1)};
+    std::vector<MailSender::Message> messages = {
+        {"a@example.com", "测试", "正文"},
+        {"b@example.com", "测试", "正文"},
+    };
+
+    auto results = MailSender::sendBatch(relays, messages);
+    Logger::shutdown();
+
+    int failures = 0;
+    std::string liveName = "127.0.0.1:" + std::to_string(live.port());
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& result = results[i];
+        if (!result.ok || result.relay != liveName) {
+            std::fprintf(stderr, "FAIL %s: ok=%d relay=%s error=%s\n", messages[i].recipient.c_str(),
+                         result.ok, result.relay.c_str(), result.error.c_str());
+            failures++;
+        }
+    }
+    if (live.delivered() != 2) {
+        std::fprintf(stderr, "FAIL 正常中继收到 %d 封邮件，应为2\n", live.delivered());
+        failures++;
+    }
+    if (failures == 0) {
+        std::printf("OK 两封邮件均经正常中继投递（故障中继尝试 %d 次）\n", results[0].attempts + results[1].attempts - 2);
+    }
+    return failures == 0 ? 0 : 1;
+}